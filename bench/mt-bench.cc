@@ -0,0 +1,239 @@
+/*
+ Multi-threaded scalability benchmark for print, fprintf and format.
+
+ Copyright (c) 2012-2014, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Usage: mt-bench [calls-per-run [max-threads]]
+//
+// For every combination of API (print, fprintf, format), sink (/dev/null,
+// a pipe drained by a reader thread and a file on tmpfs), message size and
+// thread count from 1 to max-threads this starts the threads at the same
+// time, makes each of them perform its share of calls and reports the
+// aggregate throughput and the p50/p99/p999 per-call latency.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "format.h"
+#include "posix.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+enum Api { PRINT, FPRINTF, FORMAT };
+
+const char *const API_NAMES[] = {"print", "fprintf", "format"};
+
+struct Result {
+  double calls_per_sec;
+  double p50, p99, p999;  // Latency in nanoseconds.
+};
+
+// Returns the q-th quantile of sorted latencies.
+double quantile(const std::vector<std::int64_t> &sorted, double q) {
+  std::size_t index = static_cast<std::size_t>(q * (sorted.size() - 1));
+  return static_cast<double>(sorted[index]);
+}
+
+// Makes a single call to the benchmarked API. The message consists of a
+// fixed prefix with an integer and a double followed by padding so that
+// the total output size is roughly message_size.
+inline void call(Api api, std::FILE *f, const std::string &padding, int i) {
+  switch (api) {
+  case PRINT:
+    fmt::print(f, "{} {:.3f} {}\n", i, i * 0.5, padding);
+    break;
+  case FPRINTF:
+    fmt::fprintf(f, "%d %.3f %s\n", i, i * 0.5, padding);
+    break;
+  case FORMAT: {
+    std::string s = fmt::format("{} {:.3f} {}\n", i, i * 0.5, padding);
+    // Prevent the compiler from optimizing the call away.
+    if (s.empty())
+      std::abort();
+    break;
+  }
+  }
+}
+
+Result run(Api api, std::FILE *f, std::size_t message_size,
+           unsigned num_threads, unsigned num_calls) {
+  std::string padding(message_size > 16 ? message_size - 16 : 1, 'x');
+  unsigned calls_per_thread = std::max(num_calls / num_threads, 1u);
+  std::vector< std::vector<std::int64_t> > latencies(num_threads);
+  std::atomic<unsigned> ready(0);
+  std::atomic<bool> start(false);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_threads; ++t) {
+    threads.push_back(std::thread([&, t]() {
+      std::vector<std::int64_t> &lat = latencies[t];
+      lat.resize(calls_per_thread);
+      ++ready;
+      while (!start.load())
+        std::this_thread::yield();
+      for (unsigned i = 0; i < calls_per_thread; ++i) {
+        Clock::time_point call_start = Clock::now();
+        call(api, f, padding, static_cast<int>(i));
+        lat[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - call_start).count();
+      }
+    }));
+  }
+  while (ready.load() != num_threads)
+    std::this_thread::yield();
+  Clock::time_point run_start = Clock::now();
+  start = true;
+  for (unsigned t = 0; t < num_threads; ++t)
+    threads[t].join();
+  if (f)
+    std::fflush(f);
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - run_start).count();
+
+  std::vector<std::int64_t> all;
+  all.reserve(static_cast<std::size_t>(calls_per_thread) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t)
+    all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+  std::sort(all.begin(), all.end());
+  Result r;
+  r.calls_per_sec = all.size() / seconds;
+  r.p50 = quantile(all, 0.5);
+  r.p99 = quantile(all, 0.99);
+  r.p999 = quantile(all, 0.999);
+  return r;
+}
+
+// An output destination. The pipe sink owns a reader thread that drains
+// the pipe so that writers are not blocked by a full pipe buffer.
+class Sink {
+ private:
+  std::string name_;
+  fmt::BufferedFile file_;
+  std::string path_;
+  std::thread reader_;
+
+ public:
+  Sink(const std::string &name, const std::string &path)
+  : name_(name), file_(path.c_str(), "w") {
+    if (name != "/dev/null")
+      path_ = path;
+  }
+
+  // Constructs a sink writing to a pipe.
+  Sink() : name_("pipe") {
+    fmt::File read_end, write_end;
+    fmt::File::pipe(read_end, write_end);
+    file_ = write_end.fdopen("w");
+    reader_ = std::thread([](fmt::File in) {
+      char buffer[65536];
+      while (in.read(buffer, sizeof(buffer)) != 0) {}
+    }, std::move(read_end));
+  }
+
+  ~Sink() {
+    file_.close();
+    if (reader_.joinable())
+      reader_.join();
+    if (!path_.empty())
+      std::remove(path_.c_str());
+  }
+
+  const std::string &name() const { return name_; }
+  std::FILE *get() const { return file_.get(); }
+
+  // Truncates a regular file so that runs don't grow it indefinitely.
+  void reset() {
+    std::fflush(file_.get());
+    if (!path_.empty() && ftruncate(file_.fileno(), 0) == 0)
+      std::rewind(file_.get());
+  }
+};
+
+std::string tmpfs_path() {
+  const char *dir = access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+  return fmt::format("{}/mt-bench-{}", dir, getpid());
+}
+
+void report(const char *api, const std::string &sink,
+            std::size_t message_size, unsigned num_threads, const Result &r) {
+  fmt::print("{:<8} {:<10} {:>6} {:>7} {:>14.0f} {:>9.0f} {:>9.0f} {:>9.0f}\n",
+             api, sink, message_size, num_threads, r.calls_per_sec,
+             r.p50, r.p99, r.p999);
+  std::fflush(stdout);
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned num_calls = argc > 1 ? std::atoi(argv[1]) : 100000;
+  unsigned max_threads = argc > 2 ? std::atoi(argv[2]) : 64;
+  if (num_calls == 0 || max_threads == 0) {
+    std::fprintf(stderr, "usage: mt-bench [calls-per-run [max-threads]]\n");
+    return 1;
+  }
+  static const std::size_t MESSAGE_SIZES[] = {32, 256, 4096};
+
+  fmt::print("{:<8} {:<10} {:>6} {:>7} {:>14} {:>9} {:>9} {:>9}\n",
+             "api", "sink", "size", "threads", "calls/s",
+             "p50 ns", "p99 ns", "p999 ns");
+  try {
+    std::vector<std::unique_ptr<Sink>> sinks;
+    sinks.emplace_back(new Sink("/dev/null", "/dev/null"));
+    sinks.emplace_back(new Sink());
+    sinks.emplace_back(new Sink("tmpfs", tmpfs_path()));
+    for (std::size_t s = 0; s < sizeof(MESSAGE_SIZES) / sizeof(*MESSAGE_SIZES);
+         ++s) {
+      std::size_t size = MESSAGE_SIZES[s];
+      for (unsigned n = 1; n <= max_threads; n *= 2) {
+        for (int api = PRINT; api <= FPRINTF; ++api) {
+          for (std::size_t i = 0; i < sinks.size(); ++i) {
+            Sink &sink = *sinks[i];
+            sink.reset();
+            Result r = run(static_cast<Api>(api), sink.get(), size,
+                           n, num_calls);
+            report(API_NAMES[api], sink.name(), size, n, r);
+          }
+        }
+        // format doesn't do I/O so it is benchmarked once per size and
+        // thread count rather than once per sink.
+        report(API_NAMES[FORMAT], "-", size, n,
+               run(FORMAT, 0, size, n, num_calls));
+      }
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+}
@@ -0,0 +1,114 @@
+/*
+ Throughput benchmark of formatted output to a pipe with write and vmsplice.
+
+ Copyright (c) 2012-2014, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Usage: pipe-bench [megabytes-per-run]
+//
+// For every message size this formats messages into a pipe drained by a
+// reader thread, once with fmt::MemoryWriter and fmt::File::write in 64K
+// batches and once with fmt::PipeWriter, and reports the throughput.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "format.h"
+#include "posix.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+enum { BATCH_SIZE = 65536 };
+
+enum Method { WRITE, VMSPLICE };
+
+const char *const METHOD_NAMES[] = {"write", "vmsplice"};
+
+// Formats messages of the given size into the pipe until about num_bytes
+// are written and returns the throughput in MB/s.
+double run(Method method, std::size_t message_size, std::size_t num_bytes) {
+  fmt::File read_end, write_end;
+  fmt::File::pipe(read_end, write_end);
+  std::size_t num_read = 0;
+  std::thread reader([&num_read](fmt::File in) {
+    char buffer[BATCH_SIZE];
+    while (std::size_t count = in.read(buffer, sizeof(buffer)))
+      num_read += count;
+  }, std::move(read_end));
+
+  std::string padding(message_size > 16 ? message_size - 16 : 1, 'x');
+  std::size_t num_messages = num_bytes / (padding.size() + 16) + 1;
+  Clock::time_point start = Clock::now();
+  if (method == WRITE) {
+    fmt::MemoryWriter w;
+    for (std::size_t i = 0; i < num_messages; ++i) {
+      w.write("{} {:.3f} {}\n", i, i * 0.5, padding);
+      if (w.size() >= BATCH_SIZE) {
+        fmt::FileSink(write_end).write(w.data(), w.size());
+        w.clear();
+      }
+    }
+    fmt::FileSink(write_end).write(w.data(), w.size());
+  } else {
+    fmt::PipeWriter w(write_end, BATCH_SIZE);
+    for (std::size_t i = 0; i < num_messages; ++i)
+      w.print("{} {:.3f} {}\n", i, i * 0.5, padding);
+    w.flush();
+  }
+  write_end.close();
+  reader.join();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return num_read / seconds / 1e6;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::size_t megabytes = argc > 1 ? std::atoi(argv[1]) : 1000;
+  if (megabytes == 0) {
+    std::fprintf(stderr, "usage: pipe-bench [megabytes-per-run]\n");
+    return 1;
+  }
+  static const std::size_t MESSAGE_SIZES[] = {32, 256, 4096, 65536};
+  fmt::print("{:<9} {:>6} {:>10}\n", "method", "size", "MB/s");
+  try {
+    for (std::size_t s = 0; s < sizeof(MESSAGE_SIZES) / sizeof(*MESSAGE_SIZES);
+         ++s) {
+      for (int m = WRITE; m <= VMSPLICE; ++m) {
+        double mb_per_sec = run(static_cast<Method>(m), MESSAGE_SIZES[s],
+                                megabytes * 1000000);
+        fmt::print("{:<9} {:>6} {:>10.0f}\n",
+                   METHOD_NAMES[m], MESSAGE_SIZES[s], mb_per_sec);
+        std::fflush(stdout);
+      }
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+}
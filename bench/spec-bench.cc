@@ -0,0 +1,259 @@
+/*
+ Benchmark of presentation types and format specifiers against snprintf.
+
+ Copyright (c) 2012-2014, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Usage: spec-bench [iterations [types [threshold]]]
+//
+// Generates every combination of a presentation type from doc/syntax.rst
+// with fill/align, sign, '#', width and precision, drops combinations that
+// BasicFormatter rejects, and times each remaining case through
+//   fmt    - BasicFormatter, e.g. "{:+#20.3x}",
+//   printf - PrintfFormatter with the equivalent printf specifier,
+//   libc   - snprintf with the same printf specifier.
+// Columns are per-call times in nanoseconds. Cases where fmt is slower than
+// libc by more than threshold (1.2 by default) are marked with "<<" and the
+// worst of them are listed at the end. types restricts the run to the given
+// presentation types, for example "bxX".
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "format.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+void printf_to(fmt::MemoryWriter &w, fmt::StringRef format, fmt::ArgList args) {
+  fmt::printf(w, format, args);
+}
+FMT_VARIADIC(void, printf_to, fmt::MemoryWriter &, fmt::StringRef)
+
+// A value that doesn't let the compiler discard the formatted output.
+volatile std::size_t total_size;
+
+const double NOT_AVAILABLE = -1;
+
+struct Case {
+  std::string fmt_spec;
+  std::string printf_spec;  // Empty if printf can't express fmt_spec.
+  bool libc;                // True if libc supports printf_spec.
+};
+
+struct Timing {
+  std::string name;
+  double fmt_ns, printf_ns, libc_ns;
+};
+
+// Returns the best per-call time in nanoseconds of several runs of f.
+template <typename F>
+double measure(unsigned iterations, F f) {
+  double best = 0;
+  for (int run = 0; run < 3; ++run) {
+    Clock::time_point start = Clock::now();
+    for (unsigned i = 0; i < iterations; ++i)
+      f();
+    double ns = std::chrono::duration<double, std::nano>(
+        Clock::now() - start).count() / iterations;
+    if (run == 0 || ns < best)
+      best = ns;
+  }
+  return best;
+}
+
+template <typename T>
+Timing run(const Case &c, T value, unsigned iterations) {
+  Timing t = {c.fmt_spec, 0, NOT_AVAILABLE, NOT_AVAILABLE};
+  fmt::MemoryWriter w;
+  const char *fmt_spec = c.fmt_spec.c_str();
+  t.fmt_ns = measure(iterations, [&]() {
+    w.clear();
+    w.write(fmt_spec, value);
+    total_size += w.size();
+  });
+  if (c.printf_spec.empty())
+    return t;
+  const char *printf_spec = c.printf_spec.c_str();
+  try {
+    w.clear();
+    printf_to(w, printf_spec, value);
+    t.printf_ns = measure(iterations, [&]() {
+      w.clear();
+      printf_to(w, printf_spec, value);
+      total_size += w.size();
+    });
+  } catch (const fmt::FormatError &) {
+    // PrintfFormatter doesn't support this specifier.
+  }
+  if (c.libc) {
+    char buffer[256];
+    t.libc_ns = measure(iterations, [&]() {
+      total_size += std::snprintf(buffer, sizeof(buffer), printf_spec, value);
+    });
+  }
+  return t;
+}
+
+// Generates the matrix of cases for the presentation type.
+std::vector<Case> generate(char type) {
+  bool is_int = std::strchr("dxXobBc", type) != 0;
+  bool is_float = std::strchr("aAeEfFgG", type) != 0;
+  bool is_signed = type == 'd' || is_float;
+  bool has_alt = std::strchr("xXobBaAeEfFgG", type) != 0;
+  bool libc_type = std::strchr("bB", type) == 0;
+
+  // Each alignment is {fmt fill and align, printf flag or 0 if none}.
+  static const char *const ALIGNS[][2] = {
+    {"", ""}, {"<", "-"}, {">", ""}, {"^", 0}, {"*<", 0}, {"*^", 0}
+  };
+  std::vector<Case> cases;
+  for (std::size_t a = 0; a < sizeof(ALIGNS) / sizeof(*ALIGNS); ++a) {
+    for (int sign = 0; sign < 3; ++sign) {
+      if (sign != 0 && !is_signed) continue;
+      for (int alt = 0; alt < 2; ++alt) {
+        if (alt && !has_alt) continue;
+        for (int width = 0; width < 2; ++width) {
+          if (!width && *ALIGNS[a][0]) continue;
+          for (int precision = 0; precision < 2; ++precision) {
+            if (precision && is_int) continue;
+            if (precision && type == 'p') continue;
+            const char *sign_str = sign == 0 ? "" : sign == 1 ? "+" : " ";
+            const char *alt_str = alt ? "#" : "";
+            const char *width_str = width ? "20" : "";
+            const char *precision_str = precision ? ".3" : "";
+            Case c;
+            c.fmt_spec = fmt::format("{{:{}{}{}{}{}{}}}", ALIGNS[a][0],
+                sign_str, alt_str, width_str, precision_str, type);
+            c.libc = false;
+            if (ALIGNS[a][1]) {
+              c.printf_spec = fmt::format("%{}{}{}{}{}{}", ALIGNS[a][1],
+                  sign_str, alt_str, width_str, precision_str, type);
+              c.libc = libc_type;
+            }
+            cases.push_back(c);
+          }
+        }
+      }
+    }
+  }
+  return cases;
+}
+
+template <typename T>
+void run_type(char type, T value, unsigned iterations,
+              std::vector<Timing> &timings) {
+  std::vector<Case> cases = generate(type);
+  for (std::size_t i = 0; i < cases.size(); ++i) {
+    try {
+      fmt::format(cases[i].fmt_spec, value);
+    } catch (const fmt::FormatError &) {
+      continue;  // Not a valid combination.
+    }
+    timings.push_back(run(cases[i], value, iterations));
+  }
+}
+
+std::string format_ns(double ns) {
+  return ns == NOT_AVAILABLE ? "n/a" : fmt::format("{:.1f}", ns);
+}
+
+bool is_slower(const Timing &t, double threshold) {
+  return t.libc_ns != NOT_AVAILABLE && t.fmt_ns > t.libc_ns * threshold;
+}
+
+bool by_ratio(const Timing &lhs, const Timing &rhs) {
+  return lhs.fmt_ns / lhs.libc_ns > rhs.fmt_ns / rhs.libc_ns;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? std::atoi(argv[1]) : 20000;
+  std::string types = argc > 2 ? argv[2] : "dxXobBcspaAeEfFgG";
+  double threshold = argc > 3 ? std::atof(argv[3]) : 1.2;
+  if (iterations == 0) {
+    std::fprintf(stderr, "usage: spec-bench [iterations [types [threshold]]]\n");
+    return 1;
+  }
+
+  std::vector<Timing> timings;
+  for (std::size_t i = 0; i < types.size(); ++i) {
+    char type = types[i];
+    switch (type) {
+    case 'd':
+      run_type(type, 12345, iterations, timings);
+      break;
+    case 'x': case 'X': case 'o': case 'b': case 'B':
+      run_type(type, 0xdeadbeefu, iterations, timings);
+      break;
+    case 'c':
+      run_type(type, 'x', iterations, timings);
+      break;
+    case 's':
+      run_type(type, "hello, world", iterations, timings);
+      break;
+    case 'p':
+      run_type(type, static_cast<void*>(&timings), iterations, timings);
+      break;
+    default:
+      if (!std::strchr("aAeEfFgG", type)) {
+        std::fprintf(stderr, "unknown type '%c'\n", type);
+        return 1;
+      }
+      run_type(type, 3.14159265358979, iterations, timings);
+    }
+  }
+
+  fmt::print("{:<16} {:>10} {:>10} {:>10} {:>9}\n",
+             "spec", "fmt ns", "printf ns", "libc ns", "fmt/libc");
+  std::vector<Timing> slow;
+  for (std::size_t i = 0; i < timings.size(); ++i) {
+    const Timing &t = timings[i];
+    std::string ratio = t.libc_ns == NOT_AVAILABLE ?
+          "n/a" : fmt::format("{:.2f}", t.fmt_ns / t.libc_ns);
+    bool slower = is_slower(t, threshold);
+    if (slower)
+      slow.push_back(t);
+    fmt::print("{:<16} {:>10} {:>10} {:>10} {:>9}{}\n", t.name,
+               format_ns(t.fmt_ns), format_ns(t.printf_ns),
+               format_ns(t.libc_ns), ratio, slower ? " <<" : "");
+  }
+
+  std::sort(slow.begin(), slow.end(), by_ratio);
+  fmt::print("\n{} of {} cases are more than {}x slower than libc",
+             slow.size(), timings.size(), threshold);
+  if (!slow.empty())
+    fmt::print(", worst first:");
+  fmt::print("\n");
+  for (std::size_t i = 0; i < slow.size() && i < 20; ++i) {
+    fmt::print("  {:<16} {:.2f}x\n", slow[i].name,
+               slow[i].fmt_ns / slow[i].libc_ns);
+  }
+}
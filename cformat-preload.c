@@ -0,0 +1,259 @@
+/*
+ Replacements for the C library printf functions for use with LD_PRELOAD.
+
+ Copyright (c) 2012 - 2015, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ Usage: LD_PRELOAD=/path/to/libformat-preload.so program
+
+ Overrides snprintf, vsnprintf, sprintf, vsprintf, fprintf, vfprintf,
+ printf, vprintf and their _FORTIFY_SOURCE variants (__snprintf_chk etc.)
+ with the functions from cformat.h. Format strings that the formatting
+ library doesn't handle are passed to the next definition found with
+ dlsym(RTLD_NEXT, ...), the checking variants together with their flag
+ so that the C library still rejects %n in a writable format string.
+ Calls made by the formatting library itself while a replacement is active
+ on the same thread are forwarded the same way.
+ */
+
+/* The fortified inline definitions in stdio.h would conflict with ours. */
+#undef _FORTIFY_SOURCE
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE  /* for RTLD_NEXT */
+#endif
+
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cformat.h"
+
+typedef int (*VsnprintfFunc)(char *, size_t, const char *, va_list);
+typedef int (*VsprintfFunc)(char *, const char *, va_list);
+typedef int (*VfprintfFunc)(FILE *, const char *, va_list);
+typedef int (*VsnprintfChkFunc)(
+    char *, size_t, int, size_t, const char *, va_list);
+typedef int (*VsprintfChkFunc)(char *, int, size_t, const char *, va_list);
+typedef int (*VfprintfChkFunc)(FILE *, int, const char *, va_list);
+
+/* Reports a buffer overflow the same way as the C library. */
+extern void __chk_fail(void) __attribute__((noreturn));
+
+/*
+ Nesting level of replacement functions on the current thread. The library
+ is loaded at startup, so the faster initial-exec TLS model can be used.
+ */
+static __thread int depth __attribute__((tls_model("initial-exec")));
+
+/* Next definitions of the replaced functions, resolved on first use. */
+static void *next_vsnprintf, *next_vsprintf, *next_vfprintf;
+static void *next___vsnprintf_chk, *next___vsprintf_chk, *next___vfprintf_chk;
+
+/*
+ Returns the next definition of name caching it in *func. Threads racing
+ on the first call look up and store the same pointer, and the
+ release/acquire pair makes the stored value safe to call from any thread.
+ */
+static void *next(void **func, const char *name) {
+  void *result = __atomic_load_n(func, __ATOMIC_ACQUIRE);
+  if (!result) {
+    result = dlsym(RTLD_NEXT, name);
+    if (!result)
+      abort();
+    __atomic_store_n(func, result, __ATOMIC_RELEASE);
+  }
+  return result;
+}
+
+#define FMT_NEXT(type, name) ((type)next(&next_##name, #name))
+
+int vsnprintf(char *buffer, size_t size, const char *format, va_list args) {
+  int result = 0, ok = 0;
+  if (!depth) {
+    ++depth;
+    ok = fmt_try_vsnprintf(&result, buffer, size, format, args);
+    --depth;
+    if (ok)
+      return result;
+  }
+  return FMT_NEXT(VsnprintfFunc, vsnprintf)(buffer, size, format, args);
+}
+
+int vsprintf(char *buffer, const char *format, va_list args) {
+  int result = 0, ok = 0;
+  if (!depth) {
+    ++depth;
+    ok = fmt_try_vsprintf(&result, buffer, format, args);
+    --depth;
+    if (ok)
+      return result;
+  }
+  return FMT_NEXT(VsprintfFunc, vsprintf)(buffer, format, args);
+}
+
+int vfprintf(FILE *f, const char *format, va_list args) {
+  int result = 0, ok = 0;
+  if (!depth) {
+    ++depth;
+    ok = fmt_try_vfprintf(&result, f, format, args);
+    --depth;
+    if (ok)
+      return result;
+  }
+  return FMT_NEXT(VfprintfFunc, vfprintf)(f, format, args);
+}
+
+int vprintf(const char *format, va_list args) {
+  return vfprintf(stdout, format, args);
+}
+
+int snprintf(char *buffer, size_t size, const char *format, ...) {
+  va_list args;
+  int result = 0;
+  va_start(args, format);
+  result = vsnprintf(buffer, size, format, args);
+  va_end(args);
+  return result;
+}
+
+int sprintf(char *buffer, const char *format, ...) {
+  va_list args;
+  int result = 0;
+  va_start(args, format);
+  result = vsprintf(buffer, format, args);
+  va_end(args);
+  return result;
+}
+
+int fprintf(FILE *f, const char *format, ...) {
+  va_list args;
+  int result = 0;
+  va_start(args, format);
+  result = vfprintf(f, format, args);
+  va_end(args);
+  return result;
+}
+
+int printf(const char *format, ...) {
+  va_list args;
+  int result = 0;
+  va_start(args, format);
+  result = vfprintf(stdout, format, args);
+  va_end(args);
+  return result;
+}
+
+/*
+ The checking variants called by code compiled with _FORTIFY_SOURCE.
+ The fast path never handles %n or positional arguments, which are the
+ conversions restricted by flag, so every format string that it rejects
+ is passed to the next checking function together with flag.
+ */
+
+int __vsnprintf_chk(char *buffer, size_t size, int flag, size_t buffer_size,
+                    const char *format, va_list args) {
+  int result = 0, ok = 0;
+  if (!depth && size <= buffer_size) {
+    ++depth;
+    ok = fmt_try_vsnprintf(&result, buffer, size, format, args);
+    --depth;
+    if (ok)
+      return result;
+  }
+  return FMT_NEXT(VsnprintfChkFunc, __vsnprintf_chk)(
+        buffer, size, flag, buffer_size, format, args);
+}
+
+int __snprintf_chk(char *buffer, size_t size, int flag, size_t buffer_size,
+                   const char *format, ...) {
+  va_list args;
+  int result = 0;
+  va_start(args, format);
+  result = __vsnprintf_chk(buffer, size, flag, buffer_size, format, args);
+  va_end(args);
+  return result;
+}
+
+int __vsprintf_chk(char *buffer, int flag, size_t buffer_size,
+                   const char *format, va_list args) {
+  int result = 0, ok = 0;
+  if (!depth && buffer_size != 0) {
+    ++depth;
+    ok = fmt_try_vsnprintf(&result, buffer, buffer_size, format, args);
+    --depth;
+    if (ok) {
+      if (result >= 0 && (size_t)result >= buffer_size)
+        __chk_fail();  /* The output didn't fit into the buffer. */
+      return result;
+    }
+  }
+  return FMT_NEXT(VsprintfChkFunc, __vsprintf_chk)(
+        buffer, flag, buffer_size, format, args);
+}
+
+int __sprintf_chk(char *buffer, int flag, size_t buffer_size,
+                  const char *format, ...) {
+  va_list args;
+  int result = 0;
+  va_start(args, format);
+  result = __vsprintf_chk(buffer, flag, buffer_size, format, args);
+  va_end(args);
+  return result;
+}
+
+int __vfprintf_chk(FILE *f, int flag, const char *format, va_list args) {
+  int result = 0, ok = 0;
+  if (!depth) {
+    ++depth;
+    ok = fmt_try_vfprintf(&result, f, format, args);
+    --depth;
+    if (ok)
+      return result;
+  }
+  return FMT_NEXT(VfprintfChkFunc, __vfprintf_chk)(f, flag, format, args);
+}
+
+int __fprintf_chk(FILE *f, int flag, const char *format, ...) {
+  va_list args;
+  int result = 0;
+  va_start(args, format);
+  result = __vfprintf_chk(f, flag, format, args);
+  va_end(args);
+  return result;
+}
+
+int __vprintf_chk(int flag, const char *format, va_list args) {
+  return __vfprintf_chk(stdout, flag, format, args);
+}
+
+int __printf_chk(int flag, const char *format, ...) {
+  va_list args;
+  int result = 0;
+  va_start(args, format);
+  result = __vfprintf_chk(stdout, flag, format, args);
+  va_end(args);
+  return result;
+}
@@ -0,0 +1,477 @@
+/*
+ A C interface to the printf implementation of the formatting library.
+
+ Copyright (c) 2012 - 2015, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "cformat.h"
+
+#include <limits.h>
+#include <cstring>
+
+#include "format.h"
+
+#ifndef va_copy
+# define va_copy(dest, src) ((dest) = (src))
+#endif
+
+// Check if exceptions are disabled.
+#if __GNUC__ && !__EXCEPTIONS
+# define FMT_EXCEPTIONS 0
+#endif
+#if _MSC_VER && !_HAS_EXCEPTIONS
+# define FMT_EXCEPTIONS 0
+#endif
+#ifndef FMT_EXCEPTIONS
+# define FMT_EXCEPTIONS 1
+#endif
+
+#if FMT_EXCEPTIONS
+# define FMT_TRY try
+# define FMT_CATCH(x) catch (x)
+#else
+# define FMT_TRY if (true)
+# define FMT_CATCH(x) if (false)
+#endif
+
+using fmt::FormatSpec;
+using fmt::internal::Arg;
+
+namespace {
+
+template <typename T>
+inline bool is_finite(T value) { return value - value == 0; }
+
+enum Length { NONE, HH, H, L, LL, J, Z, T, BIG_L };
+
+template <typename T>
+Arg make_arg(T value) {
+  Arg arg = fmt::internal::MakeArg<char>(value);
+  arg.type = static_cast<Arg::Type>(fmt::internal::MakeArg<char>::type(value));
+  return arg;
+}
+
+// Parses a nonnegative integer not greater than INT_MAX. Returns false on
+// overflow.
+bool parse_int(const char *&s, int &value) {
+  unsigned result = 0;
+  for (; '0' <= *s && *s <= '9'; ++s) {
+    result = result * 10 + (*s - '0');
+    if (result > static_cast<unsigned>(INT_MAX))
+      return false;
+  }
+  value = static_cast<int>(result);
+  return true;
+}
+
+// Formats an integer conversion with PrintfFormatter. The '#' flag is
+// dropped for zero the same way as in fmt::printf.
+template <typename T>
+void format_int(fmt::Writer &w, FormatSpec &spec, T value) {
+  if (value == 0)
+    spec.flags_ &= ~fmt::HASH_FLAG;
+  fmt::internal::PrintfFormatter<char>::format_arg(w, spec, make_arg(value));
+}
+
+bool format_signed(fmt::Writer &w, FormatSpec &spec,
+                   Length length, va_list &args) {
+  switch (length) {
+  case NONE:
+    format_int(w, spec, va_arg(args, int));
+    return true;
+  case HH:
+    format_int(w, spec, static_cast<int>(
+                 static_cast<signed char>(va_arg(args, int))));
+    return true;
+  case H:
+    format_int(w, spec, static_cast<int>(
+                 static_cast<short>(va_arg(args, int))));
+    return true;
+  case L:
+    format_int(w, spec, va_arg(args, long));
+    return true;
+  case LL:
+    format_int(w, spec, va_arg(args, fmt::LongLong));
+    return true;
+  case J:
+    format_int(w, spec, static_cast<fmt::LongLong>(va_arg(args, intmax_t)));
+    return true;
+  case Z:
+    // The signed type corresponding to size_t has the same size as
+    // ptrdiff_t on all supported platforms.
+  case T:
+    format_int(w, spec, static_cast<fmt::LongLong>(va_arg(args, ptrdiff_t)));
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool format_unsigned(fmt::Writer &w, FormatSpec &spec,
+                     Length length, va_list &args) {
+  switch (length) {
+  case NONE:
+    format_int(w, spec, va_arg(args, unsigned));
+    return true;
+  case HH:
+    format_int(w, spec, static_cast<unsigned>(
+                 static_cast<unsigned char>(va_arg(args, unsigned))));
+    return true;
+  case H:
+    format_int(w, spec, static_cast<unsigned>(
+                 static_cast<unsigned short>(va_arg(args, unsigned))));
+    return true;
+  case L:
+    format_int(w, spec, va_arg(args, unsigned long));
+    return true;
+  case LL:
+    format_int(w, spec, va_arg(args, fmt::ULongLong));
+    return true;
+  case J:
+    format_int(w, spec,
+               static_cast<fmt::ULongLong>(va_arg(args, uintmax_t)));
+    return true;
+  case Z:
+    format_int(w, spec, static_cast<fmt::ULongLong>(va_arg(args, size_t)));
+    return true;
+  case T:
+    format_int(w, spec,
+               static_cast<fmt::ULongLong>(va_arg(args, ptrdiff_t)));
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Formats arguments from args according to the C format string into w in
+// a single pass, reading each argument when its conversion is parsed.
+// Returns false as soon as the format string uses features that are not
+// supported by PrintfFormatter or where its output differs from that of
+// the C library; the partial output in w should be discarded then.
+// args is consumed in both cases.
+bool do_vformat(fmt::Writer &w, const char *format, va_list &args) {
+  using fmt::internal::PrintfFormatter;
+  const char *start = format;
+  for (const char *s = format; (s = std::strchr(s, '%')) != 0; ) {
+    ++s;
+    if (*s == '%') {
+      w << fmt::StringRef(start, s - start);
+      start = ++s;
+      continue;
+    }
+    if (s - 1 != start)
+      w << fmt::StringRef(start, s - 1 - start);
+
+    // Parse flags. The ' and I flags are not supported.
+    FormatSpec spec;
+    spec.align_ = fmt::ALIGN_RIGHT;
+    bool zero = false;
+    for (;; ++s) {
+      if (*s == '-')
+        spec.align_ = fmt::ALIGN_LEFT;
+      else if (*s == '+')
+        spec.flags_ |= fmt::SIGN_FLAG | fmt::PLUS_FLAG;
+      else if (*s == ' ')
+        spec.flags_ |= fmt::SIGN_FLAG;
+      else if (*s == '0')
+        zero = true;
+      else if (*s == '#')
+        spec.flags_ |= fmt::HASH_FLAG;
+      else
+        break;
+    }
+
+    // Parse width.
+    if (*s == '*') {
+      ++s;
+      int width = va_arg(args, int);
+      if (width < 0) {
+        if (width == INT_MIN)
+          return false;
+        width = -width;
+        spec.align_ = fmt::ALIGN_LEFT;  // A negative width is a '-' flag.
+      }
+      spec.width_ = width;
+    } else {
+      int width = 0;
+      if (!parse_int(s, width))
+        return false;
+      spec.width_ = width;
+    }
+    // Positional arguments are not supported.
+    if (*s == '$' || ('0' <= *s && *s <= '9'))
+      return false;
+
+    // Parse precision.
+    bool has_precision = *s == '.';
+    if (has_precision) {
+      ++s;
+      if (*s == '*') {
+        ++s;
+        int precision = va_arg(args, int);
+        // A negative precision is taken as if the precision were omitted.
+        spec.precision_ = precision < 0 ? -1 : precision;
+        if ('0' <= *s && *s <= '9')
+          return false;
+      } else if ('0' <= *s && *s <= '9') {
+        if (!parse_int(s, spec.precision_))
+          return false;
+      } else {
+        // PrintfFormatter treats an empty precision as no precision
+        // rather than zero.
+        return false;
+      }
+    }
+
+    // The '-' flag overrides '0' in the C library.
+    bool minus = spec.align_ == fmt::ALIGN_LEFT;
+    if (minus && zero)
+      return false;
+
+    // Parse length.
+    Length length = NONE;
+    switch (*s) {
+    case 'h':
+      length = *++s == 'h' ? (++s, HH) : H;
+      break;
+    case 'l':
+      length = *++s == 'l' ? (++s, LL) : L;
+      break;
+    case 'j':
+      ++s;
+      length = J;
+      break;
+    case 'z':
+      ++s;
+      length = Z;
+      break;
+    case 't':
+      ++s;
+      length = T;
+      break;
+    case 'L':
+      ++s;
+      length = BIG_L;
+      break;
+    }
+
+    // Parse type and format the argument. PrintfFormatter formats the
+    // following differently from the C library: integers with precision,
+    // sign flags with unsigned conversions, '#' with truncated integers,
+    // left-aligned chars, flags with pointers and zero-padded infinity,
+    // NaN or hexadecimal floating-point numbers.
+    if (spec.flag(fmt::HASH_FLAG) && (length == HH || length == H))
+      return false;
+    bool sign = spec.flag(fmt::SIGN_FLAG);
+    char type = *s++;
+    spec.type_ = type;
+    if (zero) {
+      // The '0' flag only applies to numeric conversions.
+      spec.fill_ = '0';
+      spec.align_ = fmt::ALIGN_NUMERIC;
+    }
+    switch (type) {
+    case 'd': case 'i':
+      spec.type_ = 'd';
+      if (has_precision || !format_signed(w, spec, length, args))
+        return false;
+      break;
+    case 'u':
+      spec.type_ = 'd';
+      // Fall through.
+    case 'o': case 'x': case 'X':
+      if (has_precision || sign || !format_unsigned(w, spec, length, args))
+        return false;
+      break;
+    case 'c':
+      if (length != NONE || minus)
+        return false;
+      PrintfFormatter<char>::format_arg(
+            w, spec, make_arg(static_cast<char>(va_arg(args, int))));
+      break;
+    case 's': {
+      if (length != NONE)
+        return false;  // Wide strings are not supported.
+      const char *str = va_arg(args, const char*);
+      if (!str)
+        return false;  // The C library prints "(null)".
+      spec.fill_ = ' ';
+      spec.align_ = minus ? fmt::ALIGN_LEFT : fmt::ALIGN_RIGHT;
+      PrintfFormatter<char>::format_arg(w, spec, make_arg(str));
+      break;
+    }
+    case 'p': {
+      if (length != NONE || sign || zero || has_precision)
+        return false;
+      void *ptr = va_arg(args, void*);
+      if (!ptr)
+        return false;  // The C library prints "(nil)".
+      PrintfFormatter<char>::format_arg(w, spec, make_arg(ptr));
+      break;
+    }
+    case 'a': case 'A':
+      if (zero)
+        return false;
+      // Fall through.
+    case 'e': case 'E': case 'f': case 'F':
+    case 'g': case 'G':
+      if (length == BIG_L) {
+        long double value = va_arg(args, long double);
+        if (zero && !is_finite(value))
+          return false;
+        PrintfFormatter<char>::format_arg(w, spec, make_arg(value));
+      } else if (length == NONE || length == L) {
+        double value = va_arg(args, double);
+        if (zero && !is_finite(value))
+          return false;
+        PrintfFormatter<char>::format_arg(w, spec, make_arg(value));
+      } else {
+        return false;
+      }
+      break;
+    default:
+      // %n, %m, wide characters and invalid conversions.
+      return false;
+    }
+    start = s;
+  }
+  w << fmt::StringRef(start);
+  return true;
+}
+
+// Formats arguments from args according to the C format string into w.
+// Returns false if the formatting should be done by the C library instead.
+// args is not consumed.
+bool vformat(fmt::Writer &w, const char *format, va_list args) {
+  if (!format)
+    return false;
+  bool ok = false;
+  va_list args_copy;
+  va_copy(args_copy, args);
+  FMT_TRY {
+    ok = do_vformat(w, format, args_copy);
+  } FMT_CATCH(...) {}
+  va_end(args_copy);
+  // The result of the C functions is an int.
+  return ok && w.size() <= static_cast<std::size_t>(INT_MAX);
+}
+
+// Copies the output to buffer of the given size truncating it if necessary.
+int copy(const fmt::Writer &w, char *buffer, size_t size) {
+  std::size_t n = w.size();
+  if (size != 0) {
+    std::size_t num_copied = n < size ? n : size - 1;
+    std::memcpy(buffer, w.data(), num_copied);
+    buffer[num_copied] = '\0';
+  }
+  return static_cast<int>(n);
+}
+}  // namespace
+
+int fmt_snprintf(char *buffer, size_t size, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int result = fmt_vsnprintf(buffer, size, format, args);
+  va_end(args);
+  return result;
+}
+
+int fmt_vsnprintf(char *buffer, size_t size, const char *format,
+                  va_list args) {
+  int result = 0;
+  if (!fmt_try_vsnprintf(&result, buffer, size, format, args))
+    return vsnprintf(buffer, size, format, args);
+  return result;
+}
+
+int fmt_sprintf(char *buffer, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int result = fmt_vsprintf(buffer, format, args);
+  va_end(args);
+  return result;
+}
+
+int fmt_vsprintf(char *buffer, const char *format, va_list args) {
+  int result = 0;
+  if (!fmt_try_vsprintf(&result, buffer, format, args))
+    return vsprintf(buffer, format, args);
+  return result;
+}
+
+int fmt_fprintf(FILE *f, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int result = fmt_vfprintf(f, format, args);
+  va_end(args);
+  return result;
+}
+
+int fmt_vfprintf(FILE *f, const char *format, va_list args) {
+  int result = 0;
+  if (!fmt_try_vfprintf(&result, f, format, args))
+    return vfprintf(f, format, args);
+  return result;
+}
+
+int fmt_printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int result = fmt_vfprintf(stdout, format, args);
+  va_end(args);
+  return result;
+}
+
+int fmt_vprintf(const char *format, va_list args) {
+  return fmt_vfprintf(stdout, format, args);
+}
+
+int fmt_try_vsnprintf(int *result, char *buffer, size_t size,
+                      const char *format, va_list args) {
+  fmt::MemoryWriter w;
+  if (!vformat(w, format, args))
+    return 0;
+  *result = copy(w, buffer, size);
+  return 1;
+}
+
+int fmt_try_vsprintf(int *result, char *buffer, const char *format,
+                     va_list args) {
+  fmt::MemoryWriter w;
+  if (!vformat(w, format, args))
+    return 0;
+  *result = copy(w, buffer, w.size() + 1);
+  return 1;
+}
+
+int fmt_try_vfprintf(int *result, FILE *f, const char *format,
+                     va_list args) {
+  fmt::MemoryWriter w;
+  if (!vformat(w, format, args))
+    return 0;
+  std::size_t size = w.size();
+  *result = std::fwrite(w.data(), 1, size, f) < size ?
+        -1 : static_cast<int>(size);
+  return 1;
+}
@@ -0,0 +1,76 @@
+/*
+ A C interface to the printf implementation of the formatting library.
+
+ Copyright (c) 2012 - 2015, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ These functions are drop-in replacements for the standard C functions of
+ the same name without the fmt_ prefix. Format strings and arguments follow
+ the C standard and the output is the same as that of the C library.
+ Conversions that are handled by the formatting library (integers, chars,
+ strings, pointers and floating-point numbers with any flags, width,
+ precision and length modifier) take the fast path; anything else such as
+ positional arguments, %n or wide strings is passed to the C library.
+ */
+
+#ifndef FMT_CFORMAT_H_
+#define FMT_CFORMAT_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int fmt_snprintf(char *buffer, size_t size, const char *format, ...);
+int fmt_vsnprintf(char *buffer, size_t size, const char *format, va_list args);
+int fmt_sprintf(char *buffer, const char *format, ...);
+int fmt_vsprintf(char *buffer, const char *format, va_list args);
+int fmt_fprintf(FILE *f, const char *format, ...);
+int fmt_vfprintf(FILE *f, const char *format, va_list args);
+int fmt_printf(const char *format, ...);
+int fmt_vprintf(const char *format, va_list args);
+
+/*
+ Same as fmt_vsnprintf, fmt_vsprintf and fmt_vfprintf but return 0 without
+ producing any output if the format string is not handled by the formatting
+ library instead of passing it to the C library. Otherwise they store the
+ result in *result and return 1. args is not consumed, so the caller can
+ pass it on to a C library function such as __vfprintf_chk.
+ */
+int fmt_try_vsnprintf(int *result, char *buffer, size_t size,
+                      const char *format, va_list args);
+int fmt_try_vsprintf(int *result, char *buffer, const char *format,
+                     va_list args);
+int fmt_try_vfprintf(int *result, FILE *f, const char *format,
+                     va_list args);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // FMT_CFORMAT_H_
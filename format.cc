@@ -34,6 +34,7 @@
 #include <climits>
 #include <cmath>
 #include <cstdarg>
+#include <cstdlib>
 
 #ifdef _WIN32
 # ifdef __MINGW32__
@@ -63,18 +64,6 @@ using fmt::internal::Arg;
 # define FMT_CATCH(x) if (false)
 #endif
 
-#ifndef FMT_NORETURN
-# if defined __GNUC__ || defined __clang__
-#  define FMT_NORETURN __attribute__((__noreturn__))
-# elif defined _MSC_VER
-#  define FMT_NORETURN __declspec(noreturn)
-# elif __cplusplus >= 201103L
-#  define FMT_NORETURN [[noreturn]]
-# else
-#  define FMT_NORETURN
-# endif
-#endif
-
 FMT_NORETURN
 static inline void fmt_unreachable() {
 #ifdef _MSC_VER
@@ -124,6 +113,23 @@ static inline fmt::internal::None<> strerror_s(char *, std::size_t, ...) {
 
 namespace {
 
+// Error reporting functions are kept out of line so that constructing
+// exceptions and error messages doesn't bloat the formatting code.
+FMT_NORETURN FMT_COLD FMT_NOINLINE
+void report_format_error(const char *message) {
+  (void)message;  // Unused if exceptions are disabled.
+  FMT_THROW(fmt::FormatError(message));
+}
+
+// Reports an error with a message produced by formatting arg.
+template <typename T>
+FMT_NORETURN FMT_COLD FMT_NOINLINE
+void report_format_error(const char *format_str, const T &arg) {
+  (void)format_str;
+  (void)arg;
+  FMT_THROW(fmt::FormatError(fmt::format(format_str, arg)));
+}
+
 #ifndef _MSC_VER
 # define FMT_SNPRINTF snprintf
 #else  // _MSC_VER
@@ -281,28 +287,307 @@ int parse_nonnegative_int(const Char *&s) {
     }
     value = new_value;
   } while ('0' <= *s && *s <= '9');
-  if (value > INT_MAX)
-    FMT_THROW(fmt::FormatError("number is too big"));
+  if (FMT_UNLIKELY(value > INT_MAX))
+    report_format_error("number is too big");
   return value;
 }
 
 inline void require_numeric_argument(const Arg &arg, char spec) {
-  if (arg.type > Arg::LAST_NUMERIC_TYPE) {
-    std::string message =
-        fmt::format("format specifier '{}' requires numeric argument", spec);
-    FMT_THROW(fmt::FormatError(message));
+  if (FMT_UNLIKELY(arg.type > Arg::LAST_NUMERIC_TYPE))
+    report_format_error(
+          "format specifier '{}' requires numeric argument", spec);
+}
+
+inline void check_sign(const Arg &arg, char sign) {
+  require_numeric_argument(arg, sign);
+  if (FMT_UNLIKELY(arg.type == Arg::UINT || arg.type == Arg::ULONG_LONG))
+    report_format_error("format specifier '{}' requires signed argument", sign);
+}
+
+inline void check_precision(const Arg &arg) {
+  if (FMT_UNLIKELY(arg.type < Arg::LAST_INTEGER_TYPE ||
+                   arg.type == Arg::POINTER)) {
+    report_format_error("precision not allowed in {} format specifier",
+                        arg.type == Arg::POINTER ? "pointer" : "integer");
+  }
+}
+
+// Returns the value of an argument specifying width or precision as in
+// "{:{}.{}}". what is the name of the value used in error messages.
+int get_dynamic_value(const Arg &arg, const char *what) {
+  fmt::ULongLong value = 0;
+  switch (arg.type) {
+    case Arg::INT:
+      if (FMT_UNLIKELY(arg.int_value < 0))
+        report_format_error("negative {}", what);
+      value = arg.int_value;
+      break;
+    case Arg::UINT:
+      value = arg.uint_value;
+      break;
+    case Arg::LONG_LONG:
+      if (FMT_UNLIKELY(arg.long_long_value < 0))
+        report_format_error("negative {}", what);
+      value = arg.long_long_value;
+      break;
+    case Arg::ULONG_LONG:
+      value = arg.ulong_long_value;
+      break;
+    default:
+      report_format_error("{} is not integer", what);
+  }
+  if (FMT_UNLIKELY(value > INT_MAX))
+    report_format_error("number is too big");
+  return static_cast<int>(value);
+}
+
+// Parses a format specifier starting at s, which points to the character
+// following ':', and stops at the closing '}'. Checks that depend on the
+// argument being formatted are delegated to handler which also parses
+// nested fields such as "{}" in "{:{}.{}}".
+template <typename Char, typename Handler>
+void parse_format_spec(
+    const Char *&s, fmt::FormatSpec &spec, Handler &handler) {
+  // Parse fill and alignment.
+  Char c = *s;
+  if (c && c != '}') {
+    const Char *p = s + 1;
+    spec.align_ = fmt::ALIGN_DEFAULT;
+    do {
+      switch (*p) {
+        case '<':
+          spec.align_ = fmt::ALIGN_LEFT;
+          break;
+        case '>':
+          spec.align_ = fmt::ALIGN_RIGHT;
+          break;
+        case '=':
+          spec.align_ = fmt::ALIGN_NUMERIC;
+          break;
+        case '^':
+          spec.align_ = fmt::ALIGN_CENTER;
+          break;
+      }
+      if (spec.align_ != fmt::ALIGN_DEFAULT) {
+        if (p != s) {
+          if (c == '{')
+            report_format_error("invalid fill character '{'");
+          s += 2;
+          spec.fill_ = c;
+        } else ++s;
+        if (spec.align_ == fmt::ALIGN_NUMERIC)
+          handler.require_numeric_argument('=');
+        break;
+      }
+    } while (--p >= s);
+  }
+
+  // Parse sign.
+  switch (*s) {
+    case '+':
+      handler.require_signed_argument('+');
+      spec.flags_ |= fmt::SIGN_FLAG | fmt::PLUS_FLAG;
+      ++s;
+      break;
+    case '-':
+      handler.require_signed_argument('-');
+      spec.flags_ |= fmt::MINUS_FLAG;
+      ++s;
+      break;
+    case ' ':
+      handler.require_signed_argument(' ');
+      spec.flags_ |= fmt::SIGN_FLAG;
+      ++s;
+      break;
+  }
+
+  if (*s == '#') {
+    handler.require_numeric_argument('#');
+    spec.flags_ |= fmt::HASH_FLAG;
+    ++s;
+  }
+
+  // Parse zero flag and width.
+  if (*s == '0') {
+    handler.require_numeric_argument('0');
+    spec.align_ = fmt::ALIGN_NUMERIC;
+    spec.fill_ = '0';
+    ++s;
+  }
+  if ('0' <= *s && *s <= '9') {
+    spec.width_ = parse_nonnegative_int(s);
+  } else if (*s == '{') {
+    ++s;
+    spec.width_ = handler.parse_width_field(s);
+  }
+
+  // Parse precision.
+  if (*s == '.') {
+    ++s;
+    spec.precision_ = 0;
+    if ('0' <= *s && *s <= '9') {
+      spec.precision_ = parse_nonnegative_int(s);
+    } else if (*s == '{') {
+      ++s;
+      spec.precision_ = handler.parse_precision_field(s);
+    } else {
+      report_format_error("missing precision specifier");
+    }
+    handler.check_precision();
   }
+
+  // Parse type.
+  if (*s != '}' && *s)
+    spec.type_ = static_cast<char>(*s++);
 }
 
+// Parses an argument index for a pre-parsed format string following the
+// same automatic and manual indexing rules as BasicFormatter.
 template <typename Char>
-void check_sign(const Char *&s, const Arg &arg) {
-  char sign = static_cast<char>(*s);
-  require_numeric_argument(arg, sign);
-  if (arg.type == Arg::UINT || arg.type == Arg::ULONG_LONG) {
-    FMT_THROW(fmt::FormatError(fmt::format(
-      "format specifier '{}' requires signed argument", sign)));
+int parse_arg_index(const Char *&s, int &next_arg_index) {
+  const char *error = 0;
+  int index = 0;
+  if (*s < '0' || *s > '9') {
+    if (next_arg_index >= 0)
+      index = next_arg_index++;
+    else
+      error = "cannot switch from manual to automatic argument indexing";
+  } else {
+    index = parse_nonnegative_int(s);
+    if (next_arg_index <= 0)
+      next_arg_index = -1;
+    else
+      error = "cannot switch from automatic to manual argument indexing";
   }
-  ++s;
+  if (FMT_UNLIKELY(error != 0))
+    report_format_error(
+          *s != '}' && *s != ':' ? "invalid format string" : error);
+  return index;
+}
+
+// Records checks that depend on the argument type in a part of
+// a pre-parsed format string.
+template <typename Char>
+class SpecRecorder {
+ private:
+  fmt::internal::FormatPart<Char> &part_;
+  int &next_arg_index_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(SpecRecorder);
+
+  int parse_nested_arg_index(const Char *&s) {
+    int index = parse_arg_index(s, next_arg_index_);
+    if (*s++ != '}')
+      report_format_error("invalid format string");
+    return index;
+  }
+
+ public:
+  SpecRecorder(fmt::internal::FormatPart<Char> &part, int &next_arg_index)
+  : part_(part), next_arg_index_(next_arg_index) {}
+
+  void require_numeric_argument(char spec) {
+    if (!part_.numeric_spec)
+      part_.numeric_spec = spec;
+  }
+
+  void require_signed_argument(char sign) {
+    require_numeric_argument(sign);
+    part_.sign_spec = sign;
+  }
+
+  int parse_width_field(const Char *&s) {
+    part_.width_index = parse_nested_arg_index(s);
+    return 0;
+  }
+
+  int parse_precision_field(const Char *&s) {
+    part_.precision_index = parse_nested_arg_index(s);
+    return 0;
+  }
+
+  // Precision is checked when formatting because spec.precision_ is set.
+  void check_precision() {}
+};
+
+// Handles checks in a format specifier of an integer argument of
+// a user-defined type.
+template <typename Char>
+class IntSpecHandler {
+ public:
+  void require_numeric_argument(char) {}
+  void require_signed_argument(char) {}
+
+  int parse_width_field(const Char *&) {
+    report_format_error("nested width is not supported for this type");
+    return 0;
+  }
+
+  int parse_precision_field(const Char *&) {
+    check_precision();
+    return 0;
+  }
+
+  void check_precision() {
+    report_format_error("precision not allowed in integer format specifier");
+  }
+};
+
+// Handles checks in a format specifier of a string argument of
+// a user-defined type.
+template <typename Char>
+class StrSpecHandler {
+ public:
+  void require_numeric_argument(char spec) {
+    report_format_error(
+          "format specifier '{}' requires numeric argument", spec);
+  }
+
+  void require_signed_argument(char spec) { require_numeric_argument(spec); }
+
+  int parse_width_field(const Char *&) {
+    report_format_error("nested width is not supported for this type");
+    return 0;
+  }
+
+  int parse_precision_field(const Char *&) {
+    report_format_error("nested precision is not supported for this type");
+    return 0;
+  }
+
+  void check_precision() {}
+};
+
+// Returns a pointer to the '}' closing a replacement field that starts at s
+// and ends before end. Unlike parse_format_spec this function never reads
+// past end so it is used to make sure that parsing a replacement field
+// stays within a format string that is not null-terminated.
+template <typename Char>
+const Char *find_field_end(const Char *s, const Char *end) {
+  int depth = 1;
+  for (; s != end; ++s) {
+    if (*s == '{') {
+      ++depth;
+    } else if (*s == '}' && --depth == 0) {
+      return s;
+    }
+  }
+  report_format_error("missing '}' in format string");
+  return end;
+}
+
+template <typename Char>
+inline void add_text(fmt::Buffer< fmt::internal::FormatPart<Char> > &parts,
+                     const Char *start, const Char *end) {
+  if (start == end)
+    return;
+  fmt::internal::FormatPart<Char> part = fmt::internal::FormatPart<Char>();
+  part.text = start;
+  part.size = end - start;
+  part.arg_index = -1;
+  part.width_index = -1;
+  part.precision_index = -1;
+  parts.push_back(part);
 }
 
 // Checks if an argument is a valid printf width specifier and sets
@@ -318,7 +603,7 @@ class WidthHandler : public fmt::internal::ArgVisitor<WidthHandler, unsigned> {
 
   FMT_NORETURN
   unsigned visit_unhandled_arg() {
-    FMT_THROW(fmt::FormatError("width is not integer"));
+    report_format_error("width is not integer");
   }
 
   template <typename T>
@@ -330,7 +615,7 @@ class WidthHandler : public fmt::internal::ArgVisitor<WidthHandler, unsigned> {
       width = 0 - width;
     }
     if (width > INT_MAX)
-      FMT_THROW(fmt::FormatError("number is too big"));
+      report_format_error("number is too big");
     return static_cast<unsigned>(width);
   }
 };
@@ -340,13 +625,13 @@ class PrecisionHandler :
  public:
   FMT_NORETURN
   unsigned visit_unhandled_arg() {
-    FMT_THROW(fmt::FormatError("precision is not integer"));
+    report_format_error("precision is not integer");
   }
 
   template <typename T>
   int visit_any_int(T value) {
     if (!IntChecker<std::numeric_limits<T>::is_signed>::fits_in_int(value))
-      FMT_THROW(fmt::FormatError("number is too big"));
+      report_format_error("number is too big");
     return static_cast<int>(value);
   }
 };
@@ -469,6 +754,25 @@ const char fmt::internal::BasicData<T>::DIGITS[] =
     "6061626364656667686970717273747576777879"
     "8081828384858687888990919293949596979899";
 
+template <typename T>
+const char fmt::internal::BasicData<T>::HEX_DIGITS[] =
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
 #define FMT_POWERS_OF_10(factor) \
   factor * 10, \
   factor * 100, \
@@ -506,6 +810,99 @@ FMT_FUNC void fmt::internal::report_unknown_type(char code, const char *type) {
         static_cast<unsigned>(code), type)));
 }
 
+FMT_FUNC void fmt::FormatDouble::format_shortest(double value) {
+  // 17 significant digits are always enough to round-trip a double but
+  // often produce noise such as 0.10000000000000001, so try fewer first.
+  int precision = std::numeric_limits<double>::digits10;
+  for (;;) {
+    size_ = FMT_SNPRINTF(buffer_, BUFFER_SIZE, "%.*g", precision, value);
+    if (precision >= 17 || std::strtod(buffer_, 0) == value)
+      break;
+    ++precision;
+  }
+}
+
+FMT_FUNC void fmt::FormatDouble::format(
+    double value, char type, int precision) {
+  char format[] = "%.*g";
+  switch (type) {
+  case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+    format[3] = type;
+    break;
+  default:
+    internal::report_unknown_type(type, "double");
+  }
+  if (precision < 0)
+    report_format_error("negative precision");
+  if (precision > MAX_PRECISION)
+    report_format_error("precision is too big");
+  size_ = FMT_SNPRINTF(buffer_, BUFFER_SIZE, format, precision, value);
+}
+
+FMT_FUNC bool fmt::internal::format_bigint(
+    const BigInt &value, char type, Buffer<char> &digits) {
+  MemoryBuffer<uint32_t, 64> words;
+  std::size_t n = value.num_words();
+  words.resize(n);
+  for (std::size_t i = 0; i < n; ++i)
+    words[i] = value.word(i);
+  while (n != 0 && words[n - 1] == 0)
+    --n;
+  if (type == 'x' || type == 'X') {
+    const char *hex_digits = type == 'x' ?
+        "0123456789abcdef" : "0123456789ABCDEF";
+    uint32_t top = n != 0 ? words[n - 1] : 0;
+    unsigned top_digits = 0;
+    do {
+      ++top_digits;
+    } while ((top >>= 4) != 0);
+    std::size_t size = top_digits + (n != 0 ? (n - 1) * 8 : 0);
+    digits.resize(size);
+    char *p = &digits[0] + size;
+    for (std::size_t i = 0; i + 1 < n; ++i) {
+      uint32_t word = words[i];
+      for (int j = 0; j < 8; ++j, word >>= 4)
+        *--p = hex_digits[word & 0xf];
+    }
+    top = n != 0 ? words[n - 1] : 0;
+    do {
+      *--p = hex_digits[top & 0xf];
+    } while ((top >>= 4) != 0);
+    return value.negative() && n != 0;
+  }
+  if (type != 0 && type != 'd')
+    report_unknown_type(type, "integer");
+  // Divide the value by 10^9 producing nine decimal digits on each pass
+  // over the words until the rest fits in 64 bits.
+  enum { CHUNK_DIGITS = 9 };
+  const uint32_t CHUNK = 1000000000;
+  MemoryBuffer<uint32_t, 64> chunks;
+  while (n > 2) {
+    uint64_t rem = 0;
+    for (std::size_t i = n; i-- > 0; ) {
+      uint64_t current = (rem << 32) | words[i];
+      words[i] = static_cast<uint32_t>(current / CHUNK);
+      rem = current % CHUNK;
+    }
+    chunks.push_back(static_cast<uint32_t>(rem));
+    while (n != 0 && words[n - 1] == 0)
+      --n;
+  }
+  // The rest is nonzero if there are chunks because it is at least
+  // 2^64 / 10^9 after the last pass.
+  uint64_t high = n == 0 ? 0 : words[0];
+  if (n == 2)
+    high |= static_cast<uint64_t>(words[1]) << 32;
+  unsigned high_digits = count_digits(high);
+  digits.resize(high_digits + chunks.size() * CHUNK_DIGITS);
+  char *p = &digits[0];
+  format_decimal(p, high, high_digits);
+  p += high_digits;
+  for (std::size_t i = chunks.size(); i-- > 0; p += CHUNK_DIGITS)
+    format_decimal_padded(p, chunks[i], count_digits(chunks[i]), CHUNK_DIGITS);
+  return value.negative() && high != 0;
+}
+
 #ifdef _WIN32
 
 FMT_FUNC fmt::internal::UTF8ToUTF16::UTF8ToUTF16(fmt::StringRef s) {
@@ -633,7 +1030,7 @@ class fmt::internal::ArgFormatter :
       return;
     }
     if (spec_.align_ == ALIGN_NUMERIC || spec_.flags_ != 0)
-      FMT_THROW(FormatError("invalid format specifier for char"));
+      report_format_error("invalid format specifier for char");
     typedef typename fmt::BasicWriter<Char>::CharPtr CharPtr;
     Char fill = static_cast<Char>(spec_.fill());
     if (spec_.precision_ == 0) {
@@ -673,7 +1070,7 @@ class fmt::internal::ArgFormatter :
   }
 
   void visit_custom(Arg::CustomValue c) {
-    c.format(&formatter_, c.value, &format_);
+    c.ops->format(&formatter_, c.value, &format_);
   }
 };
 
@@ -694,7 +1091,7 @@ void fmt::BasicWriter<Char>::write_str(
   std::size_t str_size = s.size;
   if (str_size == 0) {
     if (!str_value)
-      FMT_THROW(FormatError("string pointer is null"));
+      report_format_error("string pointer is null");
     if (*str_value)
       str_size = std::char_traits<StrChar>::length(str_value);
   }
@@ -709,10 +1106,9 @@ inline Arg fmt::BasicFormatter<Char>::parse_arg_index(const Char *&s) {
   const char *error = 0;
   Arg arg = *s < '0' || *s > '9' ?
         next_arg(error) : get_arg(parse_nonnegative_int(s), error);
-  if (error) {
-    FMT_THROW(FormatError(
-                *s != '}' && *s != ':' ? "invalid format string" : error));
-  }
+  if (FMT_UNLIKELY(error != 0))
+    report_format_error(
+          *s != '}' && *s != ':' ? "invalid format string" : error);
   return arg;
 }
 
@@ -776,7 +1172,7 @@ Arg fmt::internal::PrintfFormatter<Char>::get_arg(
   Arg arg = arg_index == UINT_MAX ?
     next_arg(error) : FormatterBase::get_arg(arg_index - 1, error);
   if (error)
-    FMT_THROW(FormatError(!*s ? "invalid format string" : error));
+    report_format_error(!*s ? "invalid format string" : error);
   return arg;
 }
 
@@ -892,7 +1288,7 @@ void fmt::internal::PrintfFormatter<Char>::format(
 
     // Parse type.
     if (!*s)
-      FMT_THROW(FormatError("invalid format string"));
+      report_format_error("invalid format string");
     spec.type_ = static_cast<char>(*s++);
     if (arg.type <= Arg::LAST_INTEGER_TYPE) {
       // Normalize type.
@@ -908,77 +1304,133 @@ void fmt::internal::PrintfFormatter<Char>::format(
     }
 
     start = s;
+    format_arg(writer, spec, arg);
+  }
+  write(writer, start, s);
+}
 
-    // Format argument.
-    switch (arg.type) {
-    case Arg::INT:
+template <typename Char>
+void fmt::internal::PrintfFormatter<Char>::format_arg(
+    BasicWriter<Char> &writer, FormatSpec &spec, Arg arg) {
+  switch (arg.type) {
+  case Arg::INT:
+    writer.write_int(arg.int_value, spec);
+    break;
+  case Arg::UINT:
+    writer.write_int(arg.uint_value, spec);
+    break;
+  case Arg::LONG_LONG:
+    writer.write_int(arg.long_long_value, spec);
+    break;
+  case Arg::ULONG_LONG:
+    writer.write_int(arg.ulong_long_value, spec);
+    break;
+  case Arg::CHAR: {
+    if (spec.type_ && spec.type_ != 'c')
       writer.write_int(arg.int_value, spec);
-      break;
-    case Arg::UINT:
-      writer.write_int(arg.uint_value, spec);
-      break;
-    case Arg::LONG_LONG:
-      writer.write_int(arg.long_long_value, spec);
-      break;
-    case Arg::ULONG_LONG:
-      writer.write_int(arg.ulong_long_value, spec);
-      break;
-    case Arg::CHAR: {
-      if (spec.type_ && spec.type_ != 'c')
-        writer.write_int(arg.int_value, spec);
-      typedef typename BasicWriter<Char>::CharPtr CharPtr;
-      CharPtr out = CharPtr();
-      if (spec.width_ > 1) {
-        Char fill = ' ';
-        out = writer.grow_buffer(spec.width_);
-        if (spec.align_ != ALIGN_LEFT) {
-          std::fill_n(out, spec.width_ - 1, fill);
-          out += spec.width_ - 1;
-        } else {
-          std::fill_n(out + 1, spec.width_ - 1, fill);
-        }
+    typedef typename BasicWriter<Char>::CharPtr CharPtr;
+    CharPtr out = CharPtr();
+    if (spec.width_ > 1) {
+      Char fill = ' ';
+      out = writer.grow_buffer(spec.width_);
+      if (spec.align_ != ALIGN_LEFT) {
+        std::fill_n(out, spec.width_ - 1, fill);
+        out += spec.width_ - 1;
       } else {
-        out = writer.grow_buffer(1);
+        std::fill_n(out + 1, spec.width_ - 1, fill);
       }
-      *out = static_cast<Char>(arg.int_value);
-      break;
-    }
-    case Arg::DOUBLE:
-      writer.write_double(arg.double_value, spec);
-      break;
-    case Arg::LONG_DOUBLE:
-      writer.write_double(arg.long_double_value, spec);
-      break;
-    case Arg::CSTRING:
-      arg.string.size = 0;
-      writer.write_str(arg.string, spec);
-      break;
-    case Arg::STRING:
-      writer.write_str(arg.string, spec);
-      break;
-    case Arg::WSTRING:
-      writer.write_str(ignore_incompatible_str<Char>(arg.wstring), spec);
-      break;
-    case Arg::POINTER:
-      if (spec.type_ && spec.type_ != 'p')
-        internal::report_unknown_type(spec.type_, "pointer");
-      spec.flags_= HASH_FLAG;
-      spec.type_ = 'x';
-      writer.write_int(reinterpret_cast<uintptr_t>(arg.pointer), spec);
-      break;
-    case Arg::CUSTOM: {
-      if (spec.type_)
-        internal::report_unknown_type(spec.type_, "object");
-      const void *str_format = "s";
-      arg.custom.format(&writer, arg.custom.value, &str_format);
-      break;
-    }
-    default:
-      assert(false);
-      break;
+    } else {
+      out = writer.grow_buffer(1);
     }
+    *out = static_cast<Char>(arg.int_value);
+    break;
+  }
+  case Arg::DOUBLE:
+    writer.write_double(arg.double_value, spec);
+    break;
+  case Arg::LONG_DOUBLE:
+    writer.write_double(arg.long_double_value, spec);
+    break;
+  case Arg::CSTRING:
+    arg.string.size = 0;
+    writer.write_str(arg.string, spec);
+    break;
+  case Arg::STRING:
+    writer.write_str(arg.string, spec);
+    break;
+  case Arg::WSTRING:
+    writer.write_str(ignore_incompatible_str<Char>(arg.wstring), spec);
+    break;
+  case Arg::POINTER:
+    if (spec.type_ && spec.type_ != 'p')
+      internal::report_unknown_type(spec.type_, "pointer");
+    spec.flags_= HASH_FLAG;
+    spec.type_ = 'x';
+    writer.write_int(reinterpret_cast<uintptr_t>(arg.pointer), spec);
+    break;
+  case Arg::CUSTOM: {
+    if (spec.type_)
+      internal::report_unknown_type(spec.type_, "object");
+    BasicFormatter<Char> formatter(writer);
+    const Char brace[] = {'}', 0};
+    const Char *str_format = brace;
+    arg.custom.ops->format(&formatter, arg.custom.value, &str_format);
+    break;
+  }
+  default:
+    assert(false);
+    break;
   }
-  write(writer, start, s);
+}
+
+template <typename Char>
+class fmt::BasicFormatter<Char>::SpecChecker {
+ private:
+  BasicFormatter &formatter_;
+  const Arg &arg_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(SpecChecker);
+
+  // Nested fields are rare so keep them out of the main formatting code.
+  FMT_NOINLINE Arg parse_nested_arg(const Char *&s) {
+    Arg arg = formatter_.parse_arg_index(s);
+    if (*s++ != '}')
+      report_format_error("invalid format string");
+    return arg;
+  }
+
+ public:
+  SpecChecker(BasicFormatter &f, const Arg &arg) : formatter_(f), arg_(arg) {}
+
+  void require_numeric_argument(char spec) {
+    ::require_numeric_argument(arg_, spec);
+  }
+
+  void require_signed_argument(char sign) { check_sign(arg_, sign); }
+
+  int parse_width_field(const Char *&s) {
+    return get_dynamic_value(parse_nested_arg(s), "width");
+  }
+
+  int parse_precision_field(const Char *&s) {
+    return get_dynamic_value(parse_nested_arg(s), "precision");
+  }
+
+  void check_precision() { ::check_precision(arg_); }
+};
+
+template <typename Char>
+void fmt::BasicFormatter<Char>::format_custom(const Char *&s, const Arg &arg) {
+  const Arg::CustomOps &ops = *arg.custom.ops;
+  if (!ops.parse) {
+    ops.format(this, arg.custom.value, &s);
+    return;
+  }
+  if (*s == ':')
+    ++s;
+  ops.format(this, arg.custom.value, &s);
+  if (*s++ != '}')
+    report_format_error("missing '}' in format string");
 }
 
 template <typename Char>
@@ -988,130 +1440,17 @@ const Char *fmt::BasicFormatter<Char>::format(
   FormatSpec spec;
   if (*s == ':') {
     if (arg.type == Arg::CUSTOM) {
-      arg.custom.format(this, arg.custom.value, &s);
+      format_custom(s, arg);
+      start_ = s;
       return s;
     }
     ++s;
-    // Parse fill and alignment.
-    if (Char c = *s) {
-      const Char *p = s + 1;
-      spec.align_ = ALIGN_DEFAULT;
-      do {
-        switch (*p) {
-          case '<':
-            spec.align_ = ALIGN_LEFT;
-            break;
-          case '>':
-            spec.align_ = ALIGN_RIGHT;
-            break;
-          case '=':
-            spec.align_ = ALIGN_NUMERIC;
-            break;
-          case '^':
-            spec.align_ = ALIGN_CENTER;
-            break;
-        }
-        if (spec.align_ != ALIGN_DEFAULT) {
-          if (p != s) {
-            if (c == '}') break;
-            if (c == '{')
-              FMT_THROW(FormatError("invalid fill character '{'"));
-            s += 2;
-            spec.fill_ = c;
-          } else ++s;
-          if (spec.align_ == ALIGN_NUMERIC)
-            require_numeric_argument(arg, '=');
-          break;
-        }
-      } while (--p >= s);
-    }
-
-    // Parse sign.
-    switch (*s) {
-      case '+':
-        check_sign(s, arg);
-        spec.flags_ |= SIGN_FLAG | PLUS_FLAG;
-        break;
-      case '-':
-        check_sign(s, arg);
-        spec.flags_ |= MINUS_FLAG;
-        break;
-      case ' ':
-        check_sign(s, arg);
-        spec.flags_ |= SIGN_FLAG;
-        break;
-    }
-
-    if (*s == '#') {
-      require_numeric_argument(arg, '#');
-      spec.flags_ |= HASH_FLAG;
-      ++s;
-    }
-
-    // Parse width and zero flag.
-    if ('0' <= *s && *s <= '9') {
-      if (*s == '0') {
-        require_numeric_argument(arg, '0');
-        spec.align_ = ALIGN_NUMERIC;
-        spec.fill_ = '0';
-      }
-      // Zero may be parsed again as a part of the width, but it is simpler
-      // and more efficient than checking if the next char is a digit.
-      spec.width_ = parse_nonnegative_int(s);
-    }
-
-    // Parse precision.
-    if (*s == '.') {
-      ++s;
-      spec.precision_ = 0;
-      if ('0' <= *s && *s <= '9') {
-        spec.precision_ = parse_nonnegative_int(s);
-      } else if (*s == '{') {
-        ++s;
-        const Arg &precision_arg = parse_arg_index(s);
-        if (*s++ != '}')
-          FMT_THROW(FormatError("invalid format string"));
-        ULongLong value = 0;
-        switch (precision_arg.type) {
-          case Arg::INT:
-            if (precision_arg.int_value < 0)
-              FMT_THROW(FormatError("negative precision"));
-            value = precision_arg.int_value;
-            break;
-          case Arg::UINT:
-            value = precision_arg.uint_value;
-            break;
-          case Arg::LONG_LONG:
-            if (precision_arg.long_long_value < 0)
-              FMT_THROW(FormatError("negative precision"));
-            value = precision_arg.long_long_value;
-            break;
-          case Arg::ULONG_LONG:
-            value = precision_arg.ulong_long_value;
-            break;
-          default:
-            FMT_THROW(FormatError("precision is not integer"));
-        }
-        if (value > INT_MAX)
-          FMT_THROW(FormatError("number is too big"));
-        spec.precision_ = static_cast<int>(value);
-      } else {
-        FMT_THROW(FormatError("missing precision specifier"));
-      }
-      if (arg.type < Arg::LAST_INTEGER_TYPE || arg.type == Arg::POINTER) {
-        FMT_THROW(FormatError(
-            fmt::format("precision not allowed in {} format specifier",
-            arg.type == Arg::POINTER ? "pointer" : "integer")));
-      }
-    }
-
-    // Parse type.
-    if (*s != '}' && *s)
-      spec.type_ = static_cast<char>(*s++);
+    SpecChecker checker(*this, arg);
+    parse_format_spec(s, spec, checker);
   }
 
-  if (*s++ != '}')
-    FMT_THROW(FormatError("missing '}' in format string"));
+  if (FMT_UNLIKELY(*s++ != '}'))
+    report_format_error("missing '}' in format string");
   start_ = s;
 
   // Format argument.
@@ -1126,14 +1465,14 @@ void fmt::BasicFormatter<Char>::format(
   set_args(args);
   while (*s) {
     Char c = *s++;
-    if (c != '{' && c != '}') continue;
+    if (FMT_LIKELY(c != '{' && c != '}')) continue;
     if (*s == c) {
       write(writer_, start_, s);
       start_ = ++s;
       continue;
     }
-    if (c == '}')
-      FMT_THROW(FormatError("unmatched '}' in format string"));
+    if (FMT_UNLIKELY(c == '}'))
+      report_format_error("unmatched '}' in format string");
     write(writer_, start_, s - 1);
     Arg arg = parse_arg_index(s);
     s = format(s, arg);
@@ -1141,6 +1480,336 @@ void fmt::BasicFormatter<Char>::format(
   write(writer_, start_, s);
 }
 
+template <typename Char>
+void fmt::BasicFormatter<Char>::format(
+    const internal::FormatPart<Char> *parts, std::size_t num_parts,
+    const ArgList &args) {
+  set_args(args);
+  for (std::size_t i = 0; i < num_parts; ++i) {
+    const internal::FormatPart<Char> &part = parts[i];
+    if (part.arg_index < 0) {
+      write(writer_, part.text, part.text + part.size);
+      continue;
+    }
+    const char *error = 0;
+    Arg arg = get_arg(part.arg_index, error);
+    if (FMT_UNLIKELY(error != 0))
+      report_format_error(error);
+    const Char *s = part.text;
+    if (arg.type == Arg::CUSTOM) {
+      if (arg.custom.ops == part.custom_ops) {
+        part.custom_ops->format_parsed(
+              &writer_, part.custom_spec, arg.custom.value);
+      } else {
+        format_custom(s, arg);
+      }
+      continue;
+    }
+    FormatSpec spec = part.spec;
+    if (part.numeric_spec)
+      require_numeric_argument(arg, part.numeric_spec);
+    if (part.sign_spec)
+      check_sign(arg, part.sign_spec);
+    if (part.width_index >= 0) {
+      Arg width_arg = get_arg(part.width_index, error);
+      if (FMT_UNLIKELY(error != 0))
+        report_format_error(error);
+      spec.width_ = get_dynamic_value(width_arg, "width");
+    }
+    if (part.precision_index >= 0) {
+      Arg precision_arg = get_arg(part.precision_index, error);
+      if (FMT_UNLIKELY(error != 0))
+        report_format_error(error);
+      spec.precision_ = get_dynamic_value(precision_arg, "precision");
+    }
+    if (spec.precision_ >= 0)
+      check_precision(arg);
+    internal::ArgFormatter<Char>(*this, spec, s).visit(arg);
+  }
+}
+
+template <typename Char>
+void fmt::internal::parse_format(
+    BasicStringRef<Char> format_str, Buffer<FormatPart<Char> > &parts) {
+  const Char *s = format_str.c_str(), *end = s + format_str.size();
+  const Char *start = s;
+  int next_arg_index = 0;
+  while (s != end) {
+    Char c = *s++;
+    if (c != '{' && c != '}') continue;
+    if (s != end && *s == c) {
+      add_text(parts, start, s);
+      start = ++s;
+      continue;
+    }
+    if (c == '}')
+      report_format_error("unmatched '}' in format string");
+    add_text(parts, start, s - 1);
+    const Char *field_end = find_field_end(s, end);
+    FormatPart<Char> part = FormatPart<Char>();
+    part.arg_index = ::parse_arg_index(s, next_arg_index);
+    part.width_index = -1;
+    part.precision_index = -1;
+    part.text = s;
+    if (*s == ':') {
+      ++s;
+      SpecRecorder<Char> recorder(part, next_arg_index);
+      parse_format_spec(s, part.spec, recorder);
+    }
+    if (s != field_end)
+      report_format_error("missing '}' in format string");
+    parts.push_back(part);
+    start = s = field_end + 1;
+  }
+  add_text(parts, start, s);
+}
+
+template <typename Char>
+void fmt::BasicParsedFormat<Char>::set_custom_ops(
+    unsigned arg_index, const internal::Arg::CustomOps &ops) {
+  if (!ops.parse)
+    return;
+  for (std::size_t i = 0, n = parts_.size(); i < n; ++i) {
+    internal::FormatPart<Char> &part = parts_[i];
+    if (part.arg_index != static_cast<int>(arg_index))
+      continue;
+    const Char *s = part.text;
+    if (*s == ':')
+      ++s;
+    void *spec = ops.parse(&s);
+    if (*s != '}') {
+      ops.destroy(spec);
+      report_format_error("missing '}' in format string");
+    }
+    if (part.custom_spec)
+      part.custom_ops->destroy(part.custom_spec);
+    part.custom_ops = &ops;
+    part.custom_spec = spec;
+  }
+}
+
+template <typename Char>
+fmt::FormatSpec fmt::internal::parse_int_spec(const Char *&s) {
+  FormatSpec spec;
+  IntSpecHandler<Char> handler;
+  parse_format_spec(s, spec, handler);
+  return spec;
+}
+
+template <typename Char>
+fmt::FormatSpec fmt::internal::parse_str_spec(const Char *&s) {
+  FormatSpec spec;
+  StrSpecHandler<Char> handler;
+  parse_format_spec(s, spec, handler);
+  return spec;
+}
+
+namespace {
+// Returns true if a and b have the same representation. Unlike ==, this
+// distinguishes 0.0 from -0.0 which are formatted differently and treats
+// equal NaNs as equal. Padding bytes of x87 long double are ignored.
+template <typename T>
+inline bool same_bits(T a, T b) {
+  std::size_t size = std::numeric_limits<T>::digits == 64 ? 10 : sizeof(T);
+  return memcmp(&a, &b, size < sizeof(T) ? size : sizeof(T)) == 0;
+}
+}
+
+FMT_FUNC fmt::ULongLong fmt::internal::new_format_id() {
+  static ULongLong last_id;
+#if FMT_GCC_VERSION >= 401 || defined(__clang__)
+  return __sync_add_and_fetch(&last_id, 1);
+#elif defined(_WIN32)
+  return static_cast<ULongLong>(InterlockedIncrement64(
+        reinterpret_cast<volatile LONGLONG*>(&last_id)));
+#else
+  return ++last_id;
+#endif
+}
+
+template <typename Char>
+bool fmt::BasicRenderedFormat<Char>::update_arg(
+    Snapshot &snapshot, const Arg &arg) {
+  bool changed = arg.type != snapshot.arg.type;
+  const char *str = 0;
+  std::size_t size = 0;
+  switch (arg.type) {
+  case Arg::NONE:
+    break;
+  case Arg::INT: case Arg::CHAR:
+    changed = changed || arg.int_value != snapshot.arg.int_value;
+    break;
+  case Arg::UINT:
+    changed = changed || arg.uint_value != snapshot.arg.uint_value;
+    break;
+  case Arg::LONG_LONG:
+    changed = changed || arg.long_long_value != snapshot.arg.long_long_value;
+    break;
+  case Arg::ULONG_LONG:
+    changed = changed ||
+        arg.ulong_long_value != snapshot.arg.ulong_long_value;
+    break;
+  case Arg::DOUBLE:
+    changed = changed ||
+        !same_bits(arg.double_value, snapshot.arg.double_value);
+    break;
+  case Arg::LONG_DOUBLE:
+    changed = changed ||
+        !same_bits(arg.long_double_value, snapshot.arg.long_double_value);
+    break;
+  case Arg::POINTER:
+    changed = changed || arg.pointer != snapshot.arg.pointer;
+    break;
+  case Arg::CSTRING:
+    str = arg.string.value;
+    // A null string is always re-formatted to report an error.
+    if (!str)
+      changed = true;
+    else
+      size = strlen(str);
+    break;
+  case Arg::STRING:
+    str = arg.string.value;
+    size = arg.string.size;
+    break;
+  case Arg::WSTRING:
+    str = reinterpret_cast<const char*>(arg.wstring.value);
+    size = arg.wstring.size * sizeof(wchar_t);
+    break;
+  case Arg::CUSTOM:
+    changed = true;
+    break;
+  }
+  snapshot.arg = arg;
+  if (!str)
+    return changed;
+  if (!changed && size == snapshot.string_size &&
+      memcmp(str, &strings_[snapshot.string_offset], size) == 0) {
+    return false;
+  }
+  if (size > snapshot.string_capacity) {
+    snapshot.string_offset = strings_.size();
+    snapshot.string_capacity = size;
+    strings_.resize(strings_.size() + size);
+  }
+  if (size != 0)
+    memcpy(&strings_[snapshot.string_offset], str, size);
+  snapshot.string_size = size;
+  return true;
+}
+
+template <typename Char>
+void fmt::BasicRenderedFormat<Char>::shift_fields() {
+  std::size_t old_size = buffer_.size(), new_size = old_size;
+  for (std::size_t i = 0, n = updates_.size(); i < n; ++i)
+    new_size = new_size + updates_[i].size - fields_[updates_[i].part].size;
+  if (new_size > old_size)
+    buffer_.resize(new_size);
+  Char *data = &buffer_[0];
+  // Fields moving to the left are moved in ascending order and fields
+  // moving to the right in descending order, so that no field is
+  // overwritten before it is moved. Updated fields are not moved because
+  // they are replaced anyway.
+  std::size_t offset = 0, num_fields = fields_.size();
+  for (std::size_t i = 0, j = 0; i < num_fields; ++i) {
+    const Field &field = fields_[i];
+    if (j < updates_.size() && updates_[j].part == i) {
+      offset += updates_[j++].size;
+      continue;
+    }
+    if (offset < field.offset) {
+      memmove(data + offset, data + field.offset,
+                   field.size * sizeof(Char));
+    }
+    offset += field.size;
+  }
+  offset = new_size;
+  for (std::size_t i = num_fields, j = updates_.size(); i-- > 0; ) {
+    Field &field = fields_[i];
+    if (j > 0 && updates_[j - 1].part == i) {
+      field.size = updates_[--j].size;
+    } else if (offset - field.size > field.offset) {
+      memmove(data + offset - field.size, data + field.offset,
+                   field.size * sizeof(Char));
+    }
+    offset -= field.size;
+    field.offset = offset;
+  }
+  if (new_size < old_size)
+    buffer_.resize(new_size);
+}
+
+template <typename Char>
+void fmt::BasicRenderedFormat<Char>::render(
+    const BasicParsedFormat<Char> &format, const ArgList &args) {
+  const internal::FormatPart<Char> *parts = format.parts();
+  std::size_t num_parts = format.num_parts();
+  bool full = format_id_ != format.id();
+  // Reset format_id_ so that everything is re-formatted if formatting throws.
+  format_id_ = 0;
+  if (full) {
+    int max_index = -1;
+    for (std::size_t i = 0; i < num_parts; ++i) {
+      const internal::FormatPart<Char> &part = parts[i];
+      max_index = (std::max)(max_index, part.arg_index);
+      max_index = (std::max)(max_index, part.width_index);
+      max_index = (std::max)(max_index, part.precision_index);
+    }
+    args_.resize(static_cast<std::size_t>(max_index + 1));
+    strings_.clear();
+    Snapshot empty = Snapshot();
+    std::fill_n(&args_[0], args_.size(), empty);
+  }
+  for (std::size_t i = 0, n = args_.size(); i < n; ++i)
+    args_[i].changed = update_arg(args_[i], args[static_cast<unsigned>(i)]);
+  if (full) {
+    buffer_.clear();
+    fields_.resize(num_parts);
+    BufferWriter writer(buffer_);
+    BasicFormatter<Char> formatter(writer);
+    num_updated_ = 0;
+    for (std::size_t i = 0; i < num_parts; ++i) {
+      Field &field = fields_[i];
+      field.offset = buffer_.size();
+      formatter.format(parts + i, 1, args);
+      field.size = buffer_.size() - field.offset;
+      if (parts[i].arg_index >= 0)
+        ++num_updated_;
+    }
+    format_id_ = format.id();
+    return;
+  }
+  scratch_.clear();
+  updates_.clear();
+  BufferWriter writer(scratch_);
+  BasicFormatter<Char> formatter(writer);
+  bool resized = false;
+  for (std::size_t i = 0; i < num_parts; ++i) {
+    const internal::FormatPart<Char> &part = parts[i];
+    if (part.arg_index < 0 || !(changed(part.arg_index) ||
+        changed(part.width_index) || changed(part.precision_index))) {
+      continue;
+    }
+    Update update = {i, scratch_.size(), 0};
+    formatter.format(parts + i, 1, args);
+    update.size = scratch_.size() - update.offset;
+    updates_.push_back(update);
+    if (update.size != fields_[i].size)
+      resized = true;
+  }
+  if (resized)
+    shift_fields();
+  for (std::size_t i = 0, n = updates_.size(); i < n; ++i) {
+    const Update &update = updates_[i];
+    if (update.size != 0) {
+      memcpy(&buffer_[fields_[update.part].offset],
+                  &scratch_[update.offset], update.size * sizeof(Char));
+    }
+  }
+  num_updated_ = updates_.size();
+  format_id_ = format.id();
+}
+
 FMT_FUNC void fmt::report_system_error(
     int error_code, fmt::StringRef message) FMT_NOEXCEPT {
   report_error(internal::format_system_error, error_code, message);
@@ -1186,6 +1855,8 @@ FMT_FUNC int fmt::fprintf(std::FILE *f, StringRef format, ArgList args) {
 
 #ifndef FMT_HEADER_ONLY
 
+template struct fmt::internal::BasicData<void>;
+
 // Explicit instantiations for char.
 
 template void fmt::internal::FixedBuffer<char>::grow(std::size_t);
@@ -1196,9 +1867,28 @@ template const char *fmt::BasicFormatter<char>::format(
 template void fmt::BasicFormatter<char>::format(
   BasicStringRef<char> format, const ArgList &args);
 
+template void fmt::BasicFormatter<char>::format(
+  const internal::FormatPart<char> *parts, std::size_t num_parts,
+  const ArgList &args);
+
+template void fmt::internal::parse_format(
+  BasicStringRef<char> format_str, Buffer<FormatPart<char> > &parts);
+
+template void fmt::BasicParsedFormat<char>::set_custom_ops(
+  unsigned arg_index, const internal::Arg::CustomOps &ops);
+
+template class fmt::BasicRenderedFormat<char>;
+
+template fmt::FormatSpec fmt::internal::parse_int_spec(const char *&s);
+
+template fmt::FormatSpec fmt::internal::parse_str_spec(const char *&s);
+
 template void fmt::internal::PrintfFormatter<char>::format(
   BasicWriter<char> &writer, BasicStringRef<char> format, const ArgList &args);
 
+template void fmt::internal::PrintfFormatter<char>::format_arg(
+  BasicWriter<char> &writer, FormatSpec &spec, Arg arg);
+
 template int fmt::internal::CharTraits<char>::format_float(
     char *buffer, std::size_t size, const char *format,
     unsigned width, int precision, double value);
@@ -1207,6 +1897,8 @@ template int fmt::internal::CharTraits<char>::format_float(
     char *buffer, std::size_t size, const char *format,
     unsigned width, int precision, long double value);
 
+#if FMT_USE_WCHAR
+
 // Explicit instantiations for wchar_t.
 
 template void fmt::internal::FixedBuffer<wchar_t>::grow(std::size_t);
@@ -1217,10 +1909,30 @@ template const wchar_t *fmt::BasicFormatter<wchar_t>::format(
 template void fmt::BasicFormatter<wchar_t>::format(
     BasicStringRef<wchar_t> format, const ArgList &args);
 
+template void fmt::BasicFormatter<wchar_t>::format(
+    const internal::FormatPart<wchar_t> *parts, std::size_t num_parts,
+    const ArgList &args);
+
+template void fmt::internal::parse_format(
+    BasicStringRef<wchar_t> format_str,
+    Buffer<FormatPart<wchar_t> > &parts);
+
+template void fmt::BasicParsedFormat<wchar_t>::set_custom_ops(
+    unsigned arg_index, const internal::Arg::CustomOps &ops);
+
+template class fmt::BasicRenderedFormat<wchar_t>;
+
+template fmt::FormatSpec fmt::internal::parse_int_spec(const wchar_t *&s);
+
+template fmt::FormatSpec fmt::internal::parse_str_spec(const wchar_t *&s);
+
 template void fmt::internal::PrintfFormatter<wchar_t>::format(
     BasicWriter<wchar_t> &writer, BasicStringRef<wchar_t> format,
     const ArgList &args);
 
+template void fmt::internal::PrintfFormatter<wchar_t>::format_arg(
+    BasicWriter<wchar_t> &writer, FormatSpec &spec, Arg arg);
+
 template int fmt::internal::CharTraits<wchar_t>::format_float(
     wchar_t *buffer, std::size_t size, const wchar_t *format,
     unsigned width, int precision, double value);
@@ -1229,6 +1941,8 @@ template int fmt::internal::CharTraits<wchar_t>::format_float(
     wchar_t *buffer, std::size_t size, const wchar_t *format,
     unsigned width, int precision, long double value);
 
+#endif  // FMT_USE_WCHAR
+
 #endif  // FMT_HEADER_ONLY
 
 #if _MSC_VER
@@ -159,6 +159,64 @@ inline uint32_t clzll(uint64_t x) {
 # define FMT_NOEXCEPT throw()
 #endif
 
+#ifndef FMT_USE_CONSTEXPR
+# define FMT_USE_CONSTEXPR \
+   (FMT_HAS_FEATURE(cxx_constexpr) || \
+       (FMT_GCC_VERSION >= 406 && FMT_HAS_GXX_CXX11) || _MSC_VER >= 1900)
+#endif
+
+// FMT_CONSTEXPR marks functions that can be evaluated at compile time
+// when constexpr is supported.
+#if FMT_USE_CONSTEXPR
+# define FMT_CONSTEXPR constexpr
+#else
+# define FMT_CONSTEXPR inline
+#endif
+
+#ifndef FMT_NORETURN
+# if defined __GNUC__ || defined __clang__
+#  define FMT_NORETURN __attribute__((__noreturn__))
+# elif defined _MSC_VER
+#  define FMT_NORETURN __declspec(noreturn)
+# elif __cplusplus >= 201103L
+#  define FMT_NORETURN [[noreturn]]
+# else
+#  define FMT_NORETURN
+# endif
+#endif
+
+// FMT_COLD and FMT_NOINLINE are used on error reporting functions to keep
+// them out of the formatting code. FMT_LIKELY and FMT_UNLIKELY tell the
+// compiler which way a branch usually goes.
+#if FMT_GCC_VERSION >= 403 || defined __clang__
+# define FMT_COLD __attribute__((cold))
+#else
+# define FMT_COLD
+#endif
+
+#if defined __GNUC__ || defined __clang__
+# define FMT_NOINLINE __attribute__((noinline))
+#elif defined _MSC_VER
+# define FMT_NOINLINE __declspec(noinline)
+#else
+# define FMT_NOINLINE
+#endif
+
+#if FMT_GCC_VERSION >= 300 || FMT_HAS_BUILTIN(__builtin_expect)
+# define FMT_LIKELY(x) __builtin_expect(!!(x), 1)
+# define FMT_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+# define FMT_LIKELY(x) (x)
+# define FMT_UNLIKELY(x) (x)
+#endif
+
+// Define FMT_USE_WCHAR to 0 to build a narrow-only library. The wide
+// character typedefs and formatting functions are then not declared and
+// format.cc doesn't instantiate the wchar_t formatting code.
+#ifndef FMT_USE_WCHAR
+# define FMT_USE_WCHAR 1
+#endif
+
 // A macro to disallow the copy constructor and operator= functions
 // This should be used in the private: declarations for a class
 #if FMT_USE_DELETED_FUNCTIONS || FMT_HAS_FEATURE(cxx_deleted_functions) || \
@@ -187,7 +245,9 @@ template <typename Char>
 class BasicWriter;
 
 typedef BasicWriter<char> Writer;
+#if FMT_USE_WCHAR
 typedef BasicWriter<wchar_t> WWriter;
+#endif
 
 template <typename Char>
 class BasicFormatter;
@@ -195,6 +255,46 @@ class BasicFormatter;
 template <typename Char, typename T>
 void format(BasicFormatter<Char> &f, const Char *&format_str, const T &value);
 
+namespace internal {
+template <typename Char>
+class RefArg;
+}
+
+/**
+  \rst
+  A formatter for values of a user-defined type ``T`` that separates parsing
+  of a format specifier from formatting, so that a parsed specifier can be
+  stored and reused, for example, by :cpp:class:`fmt::BasicParsedFormat`.
+  Types without a ``Formatter`` specialization are formatted with
+  the ``format`` function.
+
+  **Example**::
+
+    namespace fmt {
+    template <>
+    struct Formatter<Point> {
+      // A parsed format specifier. It must be copy constructible.
+      typedef char ParsedSpec;
+
+      // Parses a format specifier starting at s, which points to the
+      // character after ':' or to the closing '}', and stops at '}'.
+      static ParsedSpec parse(const char *&s) {
+        return *s == 'p' ? *s++ : 'c';  // polar or cartesian
+      }
+
+      static void format(Writer &w, ParsedSpec spec, const Point &p) {
+        if (spec == 'p')
+          w.write("({}, {})", p.r(), p.phi());
+        else
+          w.write("({}, {})", p.x, p.y);
+      }
+    };
+    }
+  \endrst
+ */
+template <typename T, typename Char = char>
+struct Formatter {};
+
 /**
   \rst
   A string reference. It can be constructed from a C string or
@@ -322,6 +422,13 @@ class Buffer {
  public:
   virtual ~Buffer() {}
 
+  /**
+    Appends a reference to the specified elements that must stay valid while
+    the buffer is used instead of copying them if the buffer supports this.
+    Returns ``false`` if the elements should be appended as usual.
+   */
+  virtual bool append_ref(const T *, std::size_t) { return false; }
+
   /** Returns the size of this buffer. */
   std::size_t size() const { return size_; }
 
@@ -577,8 +684,12 @@ FMT_SPECIALIZE_MAKE_UNSIGNED(int, unsigned);
 FMT_SPECIALIZE_MAKE_UNSIGNED(long, unsigned long);
 FMT_SPECIALIZE_MAKE_UNSIGNED(LongLong, ULongLong);
 
+FMT_NORETURN FMT_COLD FMT_NOINLINE
 void report_unknown_type(char code, const char *type);
 
+// Returns a new nonzero id identifying a parsed format.
+ULongLong new_format_id();
+
 // Static data is placed in this class template to allow header-only
 // configuration.
 template <typename T = void>
@@ -586,6 +697,7 @@ struct BasicData {
   static const uint32_t POWERS_OF_10_32[];
   static const uint64_t POWERS_OF_10_64[];
   static const char DIGITS[];
+  static const char HEX_DIGITS[];
 };
 
 typedef BasicData<> Data;
@@ -656,6 +768,44 @@ inline void format_decimal(Char *buffer, UInt value, unsigned num_digits) {
   buffer[0] = Data::DIGITS[index];
 }
 
+// Writes two decimal digits of value which must be less than 100.
+template <typename Char>
+inline void format_2digits(Char *buffer, unsigned value) {
+  unsigned index = value * 2;
+  buffer[0] = Data::DIGITS[index];
+  buffer[1] = Data::DIGITS[index + 1];
+}
+
+// Formats a decimal unsigned integer value having num_digits digits
+// zero-padded to width digits. The common widths 2, 4 and 8 are handled
+// without loops or branches.
+template <typename UInt, typename Char>
+inline void format_decimal_padded(
+    Char *buffer, UInt value, unsigned num_digits, unsigned width) {
+  switch (width) {
+  case 2:
+    format_2digits(buffer, static_cast<unsigned>(value));
+    return;
+  case 4: {
+    unsigned n = static_cast<unsigned>(value);
+    format_2digits(buffer, n / 100);
+    format_2digits(buffer + 2, n % 100);
+    return;
+  }
+  case 8: {
+    uint32_t n = static_cast<uint32_t>(value);
+    uint32_t high = n / 10000, low = n % 10000;
+    format_2digits(buffer, high / 100);
+    format_2digits(buffer + 2, high % 100);
+    format_2digits(buffer + 4, low / 100);
+    format_2digits(buffer + 6, low % 100);
+    return;
+  }
+  }
+  std::fill_n(buffer, width - num_digits, static_cast<Char>('0'));
+  format_decimal(buffer + width - num_digits, value, num_digits);
+}
+
 #ifdef _WIN32
 // A converter from UTF-8 to UTF-16.
 // It is only provided for Windows since other systems support UTF-8 natively.
@@ -719,9 +869,22 @@ struct Arg {
   typedef void (*FormatFunc)(
       void *formatter, const void *arg, void *format_str_ptr);
 
+  // Operations on an argument of a user-defined type. format formats
+  // the argument parsing the format specifier as it goes. parse,
+  // format_parsed and destroy implement the two-phase protocol of
+  // fmt::Formatter and are null if the type doesn't support it.
+  struct CustomOps {
+    FormatFunc format;
+    // Parses a format specifier returning a new parsed specifier.
+    void *(*parse)(void *format_str_ptr);
+    void (*format_parsed)(void *writer, const void *spec, const void *arg);
+    // Destroys a parsed specifier returned by parse.
+    void (*destroy)(void *spec);
+  };
+
   struct CustomValue {
     const void *value;
-    FormatFunc format;
+    const CustomOps *ops;
   };
 
   union {
@@ -800,6 +963,83 @@ struct EnableIf {};
 template<class T>
 struct EnableIf<true, T> { typedef T type; };
 
+// Checks if fmt::Formatter is specialized for T.
+template <typename T, typename Char>
+class HasFormatter {
+ private:
+  typedef char yes[1];
+  typedef char no[2];
+
+  template <typename U>
+  static yes &check(typename Formatter<U, Char>::ParsedSpec *);
+  template <typename U>
+  static no &check(...);
+
+ public:
+  enum { value = (sizeof(check<T>(0)) == sizeof(yes)) };
+};
+
+// Operations on an argument of a user-defined type T formatted with
+// the format function.
+template <typename Char, typename T,
+          bool TWO_PHASE = HasFormatter<T, Char>::value>
+struct CustomArg {
+  static void format_arg(
+      void *formatter, const void *arg, void *format_str_ptr) {
+    format(*static_cast<BasicFormatter<Char>*>(formatter),
+           *static_cast<const Char**>(format_str_ptr),
+           *static_cast<const T*>(arg));
+  }
+
+  static const Arg::CustomOps OPS;
+};
+
+template <typename Char, typename T, bool TWO_PHASE>
+const Arg::CustomOps CustomArg<Char, T, TWO_PHASE>::OPS = {
+  &CustomArg::format_arg, 0, 0, 0
+};
+
+// Operations on an argument of a user-defined type T formatted with
+// fmt::Formatter<T, Char>. format_arg expects the format string pointer
+// to point past ':' and leaves it at the closing '}'.
+template <typename Char, typename T>
+struct CustomArg<Char, T, true> {
+  typedef Formatter<T, Char> TypeFormatter;
+  typedef typename TypeFormatter::ParsedSpec ParsedSpec;
+
+  static void format_arg(
+      void *formatter, const void *arg, void *format_str_ptr) {
+    ParsedSpec spec =
+        TypeFormatter::parse(*static_cast<const Char**>(format_str_ptr));
+    TypeFormatter::format(
+          static_cast<BasicFormatter<Char>*>(formatter)->writer(),
+          spec, *static_cast<const T*>(arg));
+  }
+
+  static void *parse_spec(void *format_str_ptr) {
+    return new ParsedSpec(
+          TypeFormatter::parse(*static_cast<const Char**>(format_str_ptr)));
+  }
+
+  static void format_parsed(void *writer, const void *spec, const void *arg) {
+    TypeFormatter::format(*static_cast<BasicWriter<Char>*>(writer),
+                          *static_cast<const ParsedSpec*>(spec),
+                          *static_cast<const T*>(arg));
+  }
+
+  static void destroy_spec(void *spec) {
+    delete static_cast<ParsedSpec*>(spec);
+  }
+
+  static const Arg::CustomOps OPS;
+};
+
+template <typename Char, typename T>
+const Arg::CustomOps CustomArg<Char, T, true>::OPS = {
+  &CustomArg::format_arg, &CustomArg::parse_spec,
+  &CustomArg::format_parsed, &CustomArg::destroy_spec
+};
+
 // Makes an Arg object from any type.
 template <typename Char>
 class MakeArg : public Arg {
@@ -834,15 +1074,6 @@ class MakeArg : public Arg {
     wstring.size = str.size();
   }
 
-  // Formats an argument of a custom type, such as a user-defined class.
-  template <typename T>
-  static void format_custom_arg(
-      void *formatter, const void *arg, void *format_str_ptr) {
-    format(*static_cast<BasicFormatter<Char>*>(formatter),
-           *static_cast<const Char**>(format_str_ptr),
-           *static_cast<const T*>(arg));
-  }
-
  public:
   MakeArg() {}
 
@@ -922,7 +1153,7 @@ class MakeArg : public Arg {
   MakeArg(const T &value,
           typename EnableIf<!IsConvertibleToInt<T>::value, int>::type = 0) {
     custom.value = &value;
-    custom.format = &format_custom_arg<T>;
+    custom.ops = &CustomArg<Char, T>::OPS;
   }
 
   template <typename T>
@@ -1099,10 +1330,136 @@ class ArgList {
   }
 };
 
+/**
+  \rst
+  A list of formatting arguments whose number is only known at runtime.
+  Arguments are added one by one with :func:`push_back()` and the list
+  is passed to formatting functions as an :class:`fmt::ArgList` returned
+  by :func:`args()`. Up to ``ArgList::MAX_PACKED_ARGS`` arguments are
+  stored in the object itself.
+
+  Arguments are stored by reference like the ones passed to formatting
+  functions directly, so they must outlive the use of the list, except for
+  strings added with :func:`push_back_copy()` which are copied to storage
+  owned by the list.
+
+  You can use one of the following typedefs for common character types:
+
+  +-----------------+------------------------------+
+  | Type            | Definition                   |
+  +=================+==============================+
+  | DynamicArgList  | BasicDynamicArgList<char>    |
+  +-----------------+------------------------------+
+  | WDynamicArgList | BasicDynamicArgList<wchar_t> |
+  +-----------------+------------------------------+
+
+  **Example**::
+
+     fmt::DynamicArgList args;
+     for (std::size_t i = 0; i < fields.size(); ++i)
+       args.push_back_copy(fields[i].to_string());
+     std::string s = fmt::format(config.template_string(), args.args());
+  \endrst
+ */
+template <typename Char>
+class BasicDynamicArgList {
+ private:
+  FMT_DISALLOW_COPY_AND_ASSIGN(BasicDynamicArgList);
+
+  // The arguments followed by a terminating argument of type NONE.
+  internal::MemoryBuffer<internal::Arg, ArgList::MAX_PACKED_ARGS + 1> args_;
+  uint64_t types_;
+
+  // A string argument that refers to a copy in strings_.
+  struct OwnedString {
+    std::size_t index;
+    std::size_t offset;
+  };
+
+  internal::MemoryBuffer<Char, 128> strings_;
+  internal::MemoryBuffer<OwnedString, 4> owned_;
+
+  void add(const internal::Arg &arg) {
+    std::size_t index = args_.size() - 1;
+    args_[index] = arg;
+    if (index < ArgList::MAX_PACKED_ARGS)
+      types_ |= static_cast<uint64_t>(arg.type) << (index * 4);
+    internal::Arg none = internal::Arg();
+    none.type = internal::Arg::NONE;
+    args_.push_back(none);
+  }
+
+  template <typename T>
+  static internal::Arg make_arg(const T &value) {
+    internal::Arg arg = internal::MakeArg<Char>(value);
+    arg.type = static_cast<internal::Arg::Type>(
+          internal::MakeArg<Char>::type(value));
+    return arg;
+  }
+
+ public:
+  BasicDynamicArgList() : types_(0) {
+    internal::Arg none = internal::Arg();
+    none.type = internal::Arg::NONE;
+    args_.push_back(none);
+  }
+
+  /** Returns the number of arguments. */
+  std::size_t size() const { return args_.size() - 1; }
+
+  /** Adds an argument that is stored by reference. */
+  template <typename T>
+  void push_back(const T &value) { add(make_arg(value)); }
+
+  /** Adds a string argument storing a copy of the string. */
+  void push_back_copy(BasicStringRef<Char> s);
+
+  /** Removes all arguments. */
+  void clear() {
+    args_.resize(1);
+    args_[0].type = internal::Arg::NONE;
+    types_ = 0;
+    strings_.clear();
+    owned_.clear();
+  }
+
+  /**
+    Returns the argument list. It is invalidated by adding arguments.
+   */
+  ArgList args() const { return ArgList(types_, &args_[0]); }
+};
+
+template <typename Char>
+void BasicDynamicArgList<Char>::push_back_copy(BasicStringRef<Char> s) {
+  std::size_t offset = strings_.size(), capacity = strings_.capacity();
+  strings_.append(s.c_str(), s.c_str() + s.size());
+  const Char *data = &strings_[0];
+  if (strings_.capacity() != capacity) {
+    // The strings have been moved, update the arguments referring to them.
+    for (std::size_t i = 0, n = owned_.size(); i < n; ++i) {
+      const OwnedString &str = owned_[i];
+      std::size_t size = i + 1 < n ?
+            owned_[i + 1].offset - str.offset : offset - str.offset;
+      args_[str.index] = make_arg(BasicStringRef<Char>(data + str.offset, size));
+    }
+  }
+  OwnedString str = {size(), offset};
+  owned_.push_back(str);
+  add(make_arg(BasicStringRef<Char>(data + offset, s.size())));
+}
+
+typedef BasicDynamicArgList<char> DynamicArgList;
+#if FMT_USE_WCHAR
+typedef BasicDynamicArgList<wchar_t> WDynamicArgList;
+#endif
+
 struct FormatSpec;
 
 namespace internal {
 
+template <typename Char>
+struct FormatPart;
+
 class FormatterBase {
  private:
   ArgList args_;
@@ -1148,6 +1505,11 @@ class PrintfFormatter : private FormatterBase {
  public:
   void format(BasicWriter<Char> &writer,
     BasicStringRef<Char> format_str, const ArgList &args);
+
+  // Formats a single argument that has already been converted according
+  // to the length modifier and whose spec has a normalized type.
+  static void format_arg(
+    BasicWriter<Char> &writer, FormatSpec &spec, Arg arg);
 };
 }  // namespace internal
 
@@ -1163,6 +1525,15 @@ class BasicFormatter : private internal::FormatterBase {
   // Parses argument index and returns corresponding argument.
   internal::Arg parse_arg_index(const Char *&s);
 
+  // Checks format specifiers against the argument being formatted.
+  class SpecChecker;
+  friend class SpecChecker;
+
+  // Formats an argument of a user-defined type. s points to ':' if
+  // the replacement field has a format specifier or to the closing '}'
+  // and is advanced past the field.
+  void format_custom(const Char *&s, const internal::Arg &arg);
+
  public:
   explicit BasicFormatter(BasicWriter<Char> &w) : writer_(w) {}
 
@@ -1170,6 +1541,10 @@ class BasicFormatter : private internal::FormatterBase {
 
   void format(BasicStringRef<Char> format_str, const ArgList &args);
 
+  // Formats num_parts parts of a pre-parsed format string.
+  void format(const internal::FormatPart<Char> *parts,
+              std::size_t num_parts, const ArgList &args);
+
   const Char *format(const Char *&format_str, const internal::Arg &arg);
 };
 
@@ -1259,6 +1634,82 @@ class IntFormatSpec : public SpecT {
   T value() const { return value_; }
 };
 
+/**
+  \rst
+  A view of an arbitrary-precision integer stored as an array of 32- or
+  64-bit limbs, least significant limb first, and a sign. The limbs are
+  not copied and should outlive the view. ``BigInt`` can be passed as
+  a formatting argument and supports the same format specifiers as other
+  integers except for precision. The presentation types are ``'d'``
+  (default), ``'x'`` and ``'X'``.
+
+  **Example**::
+
+    uint64_t limbs[] = {0, 1};  // 2**64
+    std::string s = fmt::format("{:>25}", fmt::BigInt(limbs, 2));
+    // s == "     18446744073709551616"
+  \endrst
+ */
+class BigInt {
+ private:
+  const uint32_t *limbs32_;
+  const uint64_t *limbs64_;
+  std::size_t size_;
+  bool negative_;
+
+ public:
+  BigInt(const uint32_t *limbs, std::size_t size, bool negative = false)
+  : limbs32_(limbs), limbs64_(0), size_(size), negative_(negative) {}
+
+  BigInt(const uint64_t *limbs, std::size_t size, bool negative = false)
+  : limbs32_(0), limbs64_(limbs), size_(size), negative_(negative) {}
+
+  bool negative() const { return negative_; }
+
+  // Returns the number of 32-bit words in the value.
+  std::size_t num_words() const { return limbs32_ ? size_ : size_ * 2; }
+
+  // Returns the 32-bit word with the specified index.
+  uint32_t word(std::size_t index) const {
+    return limbs32_ ? limbs32_[index] :
+        static_cast<uint32_t>(limbs64_[index / 2] >> (index % 2 * 32));
+  }
+};
+
+namespace internal {
+
+// Writes the digits of the absolute value of a big integer in the base
+// specified by type to digits. Returns true if the value is negative and
+// nonzero.
+bool format_bigint(const BigInt &value, char type, Buffer<char> &digits);
+
+// Parses a format specifier of an integer argument of a user-defined type
+// stopping at '}'. Nested width and precision are not supported.
+template <typename Char>
+FormatSpec parse_int_spec(const Char *&s);
+}
+
+template <typename Char>
+struct Formatter<BigInt, Char> {
+  typedef FormatSpec ParsedSpec;
+
+  static ParsedSpec parse(const Char *&s) {
+    FormatSpec spec = internal::parse_int_spec(s);
+    switch (spec.type()) {
+    case 0: case 'd': case 'x': case 'X':
+      break;
+    default:
+      internal::report_unknown_type(spec.type(), "integer");
+    }
+    return spec;
+  }
+
+  static void format(BasicWriter<Char> &w, const ParsedSpec &spec,
+                     const BigInt &value) {
+    w << IntFormatSpec<BigInt, FormatSpec>(value, spec);
+  }
+};
+
 // A string format specifier.
 template <typename T>
 class StrFormatSpec : public AlignSpec {
@@ -1272,6 +1723,127 @@ class StrFormatSpec : public AlignSpec {
   const T *str() const { return str_; }
 };
 
+namespace internal {
+
+// A part of a pre-parsed format string: either literal text or
+// a replacement field.
+template <typename Char>
+struct FormatPart {
+  // For literal text, the text itself. For a replacement field, the format
+  // specifier starting with ':' or, if there is none, the closing '}'.
+  // It is passed unparsed to the formatters of user-defined types.
+  const Char *text;
+  std::size_t size;
+
+  // Index of the argument to format or -1 for literal text.
+  int arg_index;
+
+  // Indices of the arguments specifying width and precision or -1 if
+  // they are not given by arguments.
+  int width_index;
+  int precision_index;
+
+  // A format specifier parsed by fmt::Formatter for an argument with
+  // the specified operations or null if it hasn't been parsed.
+  const Arg::CustomOps *custom_ops;
+  void *custom_spec;
+
+  // Checks that depend on the argument type are deferred until formatting:
+  // numeric_spec is the first specifier character that requires a numeric
+  // argument and sign_spec is the sign that requires a signed one (or 0).
+  char numeric_spec;
+  char sign_spec;
+
+  FormatSpec spec;
+};
+
+// Parses format_str into parts appending them to the buffer. format_str
+// doesn't have to be null-terminated, but it must outlive the parts.
+template <typename Char>
+void parse_format(BasicStringRef<Char> format_str,
+                  Buffer<FormatPart<Char> > &parts);
+}  // namespace internal
+
+/**
+  \rst
+  A format string parsed once and then used to format arguments any number
+  of times without parsing it again. The format string is not copied and
+  should outlive the ``BasicParsedFormat`` object.
+
+  You can use one of the following typedefs for common character types:
+
+  +----------------+----------------------------+
+  | Type           | Definition                 |
+  +================+============================+
+  | ParsedFormat   | BasicParsedFormat<char>    |
+  +----------------+----------------------------+
+  | WParsedFormat  | BasicParsedFormat<wchar_t> |
+  +----------------+----------------------------+
+
+  **Example**::
+
+    static const fmt::ParsedFormat request_format("{} {} took {:.3f}s");
+    std::string s = fmt::format(request_format, "GET", "/", 0.0042);
+  \endrst
+ */
+template <typename Char>
+class BasicParsedFormat {
+ private:
+  enum { INLINE_PARTS = 8 };
+
+  internal::MemoryBuffer<internal::FormatPart<Char>, INLINE_PARTS> parts_;
+  ULongLong id_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(BasicParsedFormat);
+
+  void set_custom_ops(unsigned arg_index, const internal::Arg::CustomOps &ops);
+
+ public:
+  /**
+    Parses a format string throwing :cpp:class:`fmt::FormatError` if it is
+    invalid. Errors that depend on argument types such as applying precision
+    to an integer are reported when formatting.
+   */
+  explicit BasicParsedFormat(BasicStringRef<Char> format_str)
+  : id_(internal::new_format_id()) {
+    internal::parse_format(format_str, parts_);
+  }
+
+  ~BasicParsedFormat() {
+    for (std::size_t i = 0, n = parts_.size(); i < n; ++i) {
+      if (parts_[i].custom_spec)
+        parts_[i].custom_ops->destroy(parts_[i].custom_spec);
+    }
+  }
+
+  /**
+    \rst
+    Declares that the argument with index *arg_index* has a user-defined
+    type ``T``. If ``T`` has a :cpp:class:`fmt::Formatter` specialization,
+    format specifiers of the fields referring to this argument are parsed
+    once here instead of every time an argument of type ``T`` is formatted.
+    This method is not thread-safe, but formatting with a ``const``
+    parsed format is.
+    \endrst
+   */
+  template <typename T>
+  void set_arg_type(unsigned arg_index) {
+    set_custom_ops(arg_index, internal::CustomArg<Char, T>::OPS);
+  }
+
+  const internal::FormatPart<Char> *parts() const { return &parts_[0]; }
+  std::size_t num_parts() const { return parts_.size(); }
+
+  // Returns an id that is unique among the parsed formats created by
+  // the program, unlike the address which can be reused.
+  ULongLong id() const { return id_; }
+};
+
+typedef BasicParsedFormat<char> ParsedFormat;
+#if FMT_USE_WCHAR
+typedef BasicParsedFormat<wchar_t> WParsedFormat;
+#endif
+
 /**
   Returns an integer format specifier to format the value in base 2.
  */
@@ -1386,10 +1958,12 @@ inline StrFormatSpec<Char> pad(
   return StrFormatSpec<Char>(str, width, fill);
 }
 
+#if FMT_USE_WCHAR
 inline StrFormatSpec<wchar_t> pad(
     const wchar_t *str, unsigned width, char fill = ' ') {
   return StrFormatSpec<wchar_t>(str, width, fill);
 }
+#endif
 
 // Generates a comma-separated list with results of applying f to
 // numbers 0..n-1.
@@ -1651,10 +2225,30 @@ class BasicWriter {
   CharPtr prepare_int_buffer(unsigned num_digits,
     const Spec &spec, const char *prefix, unsigned prefix_size);
 
+  // Returns the width of an integer of the given size including prefix if
+  // it should be zero-padded to fill the whole width, e.g. with "{:08}",
+  // and 0 otherwise.
+  template <typename Spec>
+  static unsigned zero_padded_width(
+      const Spec &spec, unsigned size, unsigned prefix_size) {
+    unsigned width = spec.width();
+    if (spec.fill() != '0' || width < size || spec.precision() >= 0)
+      return 0;
+    Alignment align = spec.align();
+    if (align == ALIGN_NUMERIC ||
+        (prefix_size == 0 && (align == ALIGN_DEFAULT || align == ALIGN_RIGHT)))
+      return width;
+    return 0;
+  }
+
   // Formats an integer.
   template <typename T, typename Spec>
   void write_int(T value, Spec spec);
 
+  // Formats an arbitrary-precision integer.
+  template <typename Spec>
+  void write_int(const BigInt &value, const Spec &spec);
+
   // Formats a floating-point number (double or long double).
   template <typename T>
   void write_double(T value, const FormatSpec &spec);
@@ -1668,6 +2262,10 @@ class BasicWriter {
   void write_str(
       const internal::Arg::StringValue<StrChar> &str, const FormatSpec &spec);
 
+  // Writes a string passed with fmt::ref() referencing it if it needs no
+  // padding and the buffer supports references.
+  void write_ref(BasicStringRef<Char> s, const FormatSpec &spec);
+
   // This following methods are private to disallow writing wide characters
   // and strings to a char stream. If you want to print a wide string as a
   // pointer as std::ostream does, cast it to const void*.
@@ -1687,6 +2285,7 @@ class BasicWriter {
 
   friend class internal::ArgFormatter<Char>;
   friend class internal::PrintfFormatter<Char>;
+  friend struct Formatter<internal::RefArg<Char>, Char>;
 
  protected:
   /**
@@ -1759,6 +2358,15 @@ class BasicWriter {
   }
   FMT_VARIADIC_VOID(write, BasicStringRef<Char>)
 
+  /**
+    Writes data formatted according to a pre-parsed format string.
+   */
+  void write(const BasicParsedFormat<Char> &format, ArgList args) {
+    BasicFormatter<Char>(*this).format(
+          format.parts(), format.num_parts(), args);
+  }
+  FMT_VARIADIC_VOID(write, const BasicParsedFormat<Char> &)
+
   BasicWriter &operator<<(int value) {
     return *this << IntFormatSpec<int>(value);
   }
@@ -1782,6 +2390,13 @@ class BasicWriter {
     return *this << IntFormatSpec<ULongLong>(value);
   }
 
+  /**
+    Formats an arbitrary-precision integer and writes it to the stream.
+   */
+  BasicWriter &operator<<(const BigInt &value) {
+    return *this << IntFormatSpec<BigInt>(value);
+  }
+
   BasicWriter &operator<<(double value) {
     write_double(value, FormatSpec());
     return *this;
@@ -1834,7 +2449,28 @@ class BasicWriter {
     return *this;
   }
 
-  void clear() FMT_NOEXCEPT { buffer_.clear(); }
+  // clear() and rollback() are virtual so that writers which keep offsets
+  // into the output can adjust them when called through the base class.
+  virtual void clear() FMT_NOEXCEPT { buffer_.clear(); }
+
+  /**
+    \rst
+    Returns a mark of the current end of the output that can be passed to
+    :func:`rollback()` to discard everything written after it.
+    \endrst
+   */
+  std::size_t mark() const FMT_NOEXCEPT { return buffer_.size(); }
+
+  /**
+    \rst
+    Discards the output written after *mark* keeping the allocated storage.
+    Does nothing if *mark* is past the end of the output.
+    \endrst
+   */
+  virtual void rollback(std::size_t mark) FMT_NOEXCEPT {
+    if (mark < buffer_.size())
+      buffer_.resize(mark);
+  }
 };
 
 template <typename Char>
@@ -1860,6 +2496,16 @@ typename BasicWriter<Char>::CharPtr BasicWriter<Char>::write_str(
   return out;
 }
 
+template <typename Char>
+void BasicWriter<Char>::write_ref(
+    BasicStringRef<Char> s, const FormatSpec &spec) {
+  std::size_t size = s.size();
+  if (spec.precision_ >= 0 && static_cast<std::size_t>(spec.precision_) < size)
+    size = spec.precision_;
+  if (spec.width() > size || !buffer_.append_ref(s.c_str(), size))
+    write_str(s.c_str(), size, spec);
+}
+
 template <typename Char>
 typename BasicWriter<Char>::CharPtr
   BasicWriter<Char>::fill_padding(
@@ -1956,6 +2602,15 @@ void BasicWriter<Char>::write_int(T value, Spec spec) {
   switch (spec.type()) {
   case 0: case 'd': {
     unsigned num_digits = internal::count_digits(abs_value);
+    unsigned width = zero_padded_width(
+        spec, prefix_size + num_digits, prefix_size);
+    if (width != 0) {
+      Char *p = get(grow_buffer(width));
+      std::copy(prefix, prefix + prefix_size, p);
+      internal::format_decimal_padded(
+          p + prefix_size, abs_value, num_digits, width - prefix_size);
+      break;
+    }
     CharPtr p = prepare_int_buffer(
       num_digits, spec, prefix, prefix_size) + 1 - num_digits;
     internal::format_decimal(get(p), abs_value, num_digits);
@@ -1971,11 +2626,21 @@ void BasicWriter<Char>::write_int(T value, Spec spec) {
     do {
       ++num_digits;
     } while ((n >>= 4) != 0);
-    Char *p = get(prepare_int_buffer(
-      num_digits, spec, prefix, prefix_size));
     n = abs_value;
     const char *digits = spec.type() == 'x' ?
         "0123456789abcdef" : "0123456789ABCDEF";
+    unsigned width = zero_padded_width(
+        spec, prefix_size + num_digits, prefix_size);
+    if (width != 0) {
+      Char *p = get(grow_buffer(width));
+      std::copy(prefix, prefix + prefix_size, p);
+      p += width - 1;
+      for (unsigned i = width - prefix_size; i != 0; --i, n >>= 4)
+        *p-- = digits[n & 0xf];
+      break;
+    }
+    Char *p = get(prepare_int_buffer(
+      num_digits, spec, prefix, prefix_size));
     do {
       *p-- = digits[n & 0xf];
     } while ((n >>= 4) != 0);
@@ -2020,6 +2685,26 @@ void BasicWriter<Char>::write_int(T value, Spec spec) {
   }
 }
 
+template <typename Char>
+template <typename Spec>
+void BasicWriter<Char>::write_int(const BigInt &value, const Spec &spec) {
+  internal::MemoryBuffer<char, internal::INLINE_BUFFER_SIZE> digits;
+  char prefix[4] = "";
+  unsigned prefix_size = 0;
+  if (internal::format_bigint(value, spec.type(), digits)) {
+    prefix[prefix_size++] = '-';
+  } else if (spec.flag(SIGN_FLAG)) {
+    prefix[prefix_size++] = spec.flag(PLUS_FLAG) ? '+' : ' ';
+  }
+  if (spec.flag(HASH_FLAG) && (spec.type() == 'x' || spec.type() == 'X')) {
+    prefix[prefix_size++] = '0';
+    prefix[prefix_size++] = spec.type();
+  }
+  unsigned num_digits = static_cast<unsigned>(digits.size());
+  CharPtr p = prepare_int_buffer(num_digits, spec, prefix, prefix_size);
+  std::copy(&digits[0], &digits[0] + num_digits, p + 1 - num_digits);
+}
+
 template <typename Char>
 template <typename T>
 void BasicWriter<Char>::write_double(
@@ -2238,7 +2923,702 @@ class BasicMemoryWriter : public BasicWriter<Char> {
 };
 
 typedef BasicMemoryWriter<char> MemoryWriter;
+#if FMT_USE_WCHAR
 typedef BasicMemoryWriter<wchar_t> WMemoryWriter;
+#endif
+
+/**
+  \rst
+  A memory writer that keeps a formatted prefix at the start of its output
+  while messages are written after it and discarded with :func:`reset()`.
+  This allows formatting a prefix that is the same for many messages, such
+  as a process id and thread name in a log, once rather than per message.
+
+  You can use one of the following typedefs for common character types
+  and the standard allocator:
+
+  +-----------------+-------------------------------------------------------+
+  | Type            | Definition                                            |
+  +=================+=======================================================+
+  | PrefixedWriter  | BasicPrefixedWriter<char, std::allocator<char>>       |
+  +-----------------+-------------------------------------------------------+
+  | WPrefixedWriter | BasicPrefixedWriter<wchar_t, std::allocator<wchar_t>> |
+  +-----------------+-------------------------------------------------------+
+
+  **Example**::
+
+     fmt::PrefixedWriter out;
+     out.write("[{}:{}] ", getpid(), thread_name);
+     out.set_prefix();
+     for (int i = 0; i < 3; ++i) {
+       out.write("processed {} items\n", i);
+       std::fwrite(out.data(), 1, out.size(), stderr);
+       out.reset();
+     }
+  \endrst
+ */
+template <typename Char, typename Allocator = std::allocator<Char> >
+class BasicPrefixedWriter : public BasicMemoryWriter<Char, Allocator> {
+ private:
+  std::size_t prefix_size_;
+
+  // Returns the prefix size limited to the output size. The output can
+  // become shorter than the prefix without rollback() or clear() being
+  // called, e.g. if a shorter writer is move-assigned to the base class.
+  std::size_t clamped_prefix_size() const FMT_NOEXCEPT {
+    return (std::min)(prefix_size_, this->size());
+  }
+
+ public:
+  explicit BasicPrefixedWriter(const Allocator& alloc = Allocator())
+    : BasicMemoryWriter<Char, Allocator>(alloc), prefix_size_(0) {}
+
+  /** Makes the output written so far the prefix. */
+  void set_prefix() FMT_NOEXCEPT { prefix_size_ = this->size(); }
+
+  /** Returns the size of the prefix. */
+  std::size_t prefix_size() const FMT_NOEXCEPT {
+    return clamped_prefix_size();
+  }
+
+  /** Returns the output written after the prefix. */
+  BasicStringRef<Char> message() const {
+    std::size_t prefix_size = clamped_prefix_size();
+    return BasicStringRef<Char>(
+          this->data() + prefix_size, this->size() - prefix_size);
+  }
+
+  /** Discards the output written after the prefix. */
+  void reset() FMT_NOEXCEPT {
+    prefix_size_ = clamped_prefix_size();
+    BasicWriter<Char>::rollback(prefix_size_);
+  }
+
+  /**
+    Discards the output written after *mark* shortening the prefix if
+    *mark* is inside it.
+   */
+  void rollback(std::size_t mark) FMT_NOEXCEPT {
+    BasicWriter<Char>::rollback(mark);
+    if (mark < prefix_size_)
+      prefix_size_ = mark;
+  }
+
+  /** Discards all output including the prefix. */
+  void clear() FMT_NOEXCEPT {
+    BasicWriter<Char>::clear();
+    prefix_size_ = 0;
+  }
+};
+
+typedef BasicPrefixedWriter<char> PrefixedWriter;
+#if FMT_USE_WCHAR
+typedef BasicPrefixedWriter<wchar_t> WPrefixedWriter;
+#endif
+
+/**
+  \rst
+  A writer that builds a table of strings in a single contiguous arena.
+  Each string is formatted directly into the arena with the usual
+  :class:`fmt::BasicWriter` methods and ended with :func:`commit()` which
+  returns a handle (offset and size) that can be passed to ``operator[]``
+  to get the string. Handles stay valid when the arena grows. If
+  deduplication is enabled, a string equal to one committed earlier is
+  discarded and the handle of the earlier string is returned.
+
+  You can use one of the following typedefs for common character types
+  and the standard allocator:
+
+  +--------------+----------------------------------------------------+
+  | Type         | Definition                                         |
+  +==============+====================================================+
+  | StringTable  | BasicStringTable<char, std::allocator<char>>       |
+  +--------------+----------------------------------------------------+
+  | WStringTable | BasicStringTable<wchar_t, std::allocator<wchar_t>> |
+  +--------------+----------------------------------------------------+
+
+  **Example**::
+
+     fmt::StringTable table(true);
+     table.write("{}.{}", "http", "requests");
+     fmt::StringTable::Entry a = table.commit();
+     fmt::StringTable::Entry b = table.add("http.requests");
+     // a and b refer to the same string "http.requests".
+
+  The allocator is used for the arena; the deduplication index uses
+  ``std::allocator``.
+  \endrst
+ */
+template <typename Char, typename Allocator = std::allocator<Char> >
+class BasicStringTable : public BasicWriter<Char> {
+ public:
+  /** A handle of a string in the table. */
+  struct Entry {
+    std::size_t offset;
+    std::size_t size;
+  };
+
+ private:
+  struct Slot {
+    std::size_t hash;
+    Entry entry;
+  };
+
+  enum { INDEX_SIZE = 16 };
+
+  internal::MemoryBuffer<Char, internal::INLINE_BUFFER_SIZE, Allocator> buffer_;
+
+  // Start of the string that is being written.
+  std::size_t start_;
+
+  // An open-addressing hash table of unique strings or empty if
+  // deduplication is disabled.
+  internal::MemoryBuffer<Slot, INDEX_SIZE> index_;
+  std::size_t num_unique_;
+  bool deduplicate_;
+
+  static const std::size_t EMPTY = ~static_cast<std::size_t>(0);
+
+  static std::size_t hash(const Char *s, std::size_t size) {
+    // FNV-1a.
+    std::size_t h = 2166136261u;
+    for (std::size_t i = 0; i < size; ++i) {
+      h ^= static_cast<std::size_t>(s[i]);
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  // Inserts a slot into the index which must have a free slot.
+  void insert(const Slot &slot) {
+    std::size_t mask = index_.size() - 1;
+    std::size_t i = slot.hash & mask;
+    while (index_[i].entry.offset != EMPTY)
+      i = (i + 1) & mask;
+    index_[i] = slot;
+  }
+
+  void grow_index();
+
+ public:
+  /**
+    Constructs a :class:`fmt::BasicStringTable` object. If *deduplicate*
+    is ``true``, equal strings are stored only once.
+   */
+  explicit BasicStringTable(bool deduplicate = false,
+                            const Allocator &alloc = Allocator())
+  : BasicWriter<Char>(buffer_), buffer_(alloc), start_(0), num_unique_(0),
+    deduplicate_(deduplicate) {}
+
+  /** Reserves space for strings of total size *size* in the arena. */
+  void reserve(std::size_t size) { buffer_.reserve(size); }
+
+  /**
+    Ends the string written since the previous call and returns its
+    handle.
+   */
+  Entry commit();
+
+  /** Appends the string *s* and commits the output. */
+  Entry add(BasicStringRef<Char> s) {
+    buffer_.append(s.c_str(), s.c_str() + s.size());
+    return commit();
+  }
+
+  /** Returns the string with the handle *e*. */
+  BasicStringRef<Char> operator[](Entry e) const {
+    return BasicStringRef<Char>(&buffer_[0] + e.offset, e.size);
+  }
+
+  /**
+    Discards the output written after *mark* but not before the start of
+    the string that is being written.
+   */
+  void rollback(std::size_t mark) FMT_NOEXCEPT {
+    BasicWriter<Char>::rollback(mark < start_ ? start_ : mark);
+  }
+
+  /** Removes all strings from the table invalidating their handles. */
+  void clear() FMT_NOEXCEPT {
+    buffer_.clear();
+    index_.clear();
+    start_ = num_unique_ = 0;
+  }
+};
+
+template <typename Char, typename Allocator>
+void BasicStringTable<Char, Allocator>::grow_index() {
+  std::size_t size = index_.size();
+  internal::MemoryBuffer<Slot, INDEX_SIZE> old;
+  if (size != 0)
+    old.append(&index_[0], &index_[0] + size);
+  index_.resize(size != 0 ? size * 2 : static_cast<std::size_t>(INDEX_SIZE));
+  for (std::size_t i = 0, n = index_.size(); i < n; ++i)
+    index_[i].entry.offset = EMPTY;
+  for (std::size_t i = 0; i < size; ++i) {
+    if (old[i].entry.offset != EMPTY)
+      insert(old[i]);
+  }
+}
+
+template <typename Char, typename Allocator>
+typename BasicStringTable<Char, Allocator>::Entry
+    BasicStringTable<Char, Allocator>::commit() {
+  // The overrides of rollback() and clear() keep start_ within the arena.
+  assert(start_ <= buffer_.size());
+  Entry e = {start_, buffer_.size() - start_};
+  if (deduplicate_) {
+    // Keep the load factor at or below 1/2.
+    if (2 * (num_unique_ + 1) > index_.size())
+      grow_index();
+    const Char *data = &buffer_[0];
+    Slot slot = {hash(data + e.offset, e.size), e};
+    std::size_t mask = index_.size() - 1;
+    for (std::size_t i = slot.hash & mask; ; i = (i + 1) & mask) {
+      const Slot &s = index_[i];
+      if (s.entry.offset == EMPTY) {
+        index_[i] = slot;
+        ++num_unique_;
+        break;
+      }
+      if (s.hash == slot.hash && s.entry.size == e.size &&
+          std::equal(data + s.entry.offset, data + s.entry.offset + e.size,
+                     data + e.offset)) {
+        buffer_.resize(start_);
+        return s.entry;
+      }
+    }
+  }
+  start_ = buffer_.size();
+  return e;
+}
+
+typedef BasicStringTable<char> StringTable;
+#if FMT_USE_WCHAR
+typedef BasicStringTable<wchar_t> WStringTable;
+#endif
+
+namespace internal {
+
+// A string argument created with fmt::ref().
+template <typename Char>
+class RefArg {
+ private:
+  BasicStringRef<Char> str_;
+
+ public:
+  explicit RefArg(BasicStringRef<Char> s) : str_(s) {}
+
+  BasicStringRef<Char> str() const { return str_; }
+};
+
+// Parses a format specifier of a string argument of a user-defined type
+// stopping at '}'. Nested width and precision are not supported.
+template <typename Char>
+FormatSpec parse_str_spec(const Char *&s);
+}
+
+template <typename Char>
+struct Formatter<internal::RefArg<Char>, Char> {
+  typedef FormatSpec ParsedSpec;
+
+  static ParsedSpec parse(const Char *&s) {
+    FormatSpec spec = internal::parse_str_spec(s);
+    if (spec.type() && spec.type() != 's')
+      internal::report_unknown_type(spec.type(), "string");
+    return spec;
+  }
+
+  static void format(BasicWriter<Char> &w, const ParsedSpec &spec,
+                     const internal::RefArg<Char> &s) {
+    w.write_ref(s.str(), spec);
+  }
+};
+
+/**
+  \rst
+  Returns a string argument that :class:`fmt::BasicGatherWriter` references
+  instead of copying if it is formatted without padding. The string must
+  stay valid while the writer output is used. Other writers copy it as
+  usual. Strings that are not passed with ``ref`` are always copied, so
+  temporaries created while formatting, for example by ``operator<<``,
+  are never referenced.
+
+  **Example**::
+
+    out.write("{}\n", fmt::ref(payload));
+  \endrst
+ */
+inline internal::RefArg<char> ref(StringRef s) {
+  return internal::RefArg<char>(s);
+}
+
+#if FMT_USE_WCHAR
+inline internal::RefArg<wchar_t> ref(WStringRef s) {
+  return internal::RefArg<wchar_t>(s);
+}
+#endif
+
+/**
+  \rst
+  A writer that references long string arguments passed with
+  :func:`fmt::ref()` instead of copying them. Such an argument of at least
+  *threshold* characters that is formatted without padding is stored as a
+  reference in a list of segments with the rest of the output copied into
+  an internal buffer as usual. The referenced strings must stay valid while
+  the writer output is used. The output can be written with a single
+  ``writev`` call using :func:`fmt::File::write()` or iterated with
+  :func:`num_segments()` and :func:`segment()`.
+
+  A gather writer provides the ``write`` and ``<<`` operations of
+  :class:`fmt::BasicWriter` but is not convertible to it since the output
+  is not contiguous.
+
+  You can use one of the following typedefs for common character types:
+
+  +---------------+----------------------------+
+  | Type          | Definition                 |
+  +===============+============================+
+  | GatherWriter  | BasicGatherWriter<char>    |
+  +---------------+----------------------------+
+  | WGatherWriter | BasicGatherWriter<wchar_t> |
+  +---------------+----------------------------+
+
+  **Example**::
+
+     fmt::GatherWriter out;
+     out.write("{} {} bytes\n{}\n", request.id(), payload.size(),
+               fmt::ref(payload));
+     file.write(out);  // payload is not copied
+  \endrst
+ */
+template <typename Char>
+class BasicGatherWriter : private BasicWriter<Char> {
+ private:
+  // A reference to a string inserted at position pos of the buffer.
+  struct Ref {
+    std::size_t pos;
+    const Char *data;
+    std::size_t size;
+  };
+
+  class GatherBuffer :
+      public internal::MemoryBuffer<Char, internal::INLINE_BUFFER_SIZE> {
+   public:
+    internal::MemoryBuffer<Ref, 8> refs;
+    std::size_t ref_size;  // The total size of referenced strings.
+    std::size_t threshold;
+
+    explicit GatherBuffer(std::size_t min_ref_size)
+    : ref_size(0), threshold(min_ref_size) {}
+
+    bool append_ref(const Char *data, std::size_t size) {
+      if (size < threshold)
+        return false;
+      Ref ref = {this->size(), data, size};
+      refs.push_back(ref);
+      ref_size += size;
+      return true;
+    }
+  };
+
+  GatherBuffer buffer_;
+
+ public:
+  /**
+    Constructs a :class:`fmt::BasicGatherWriter` object that references
+    string arguments of at least *threshold* characters.
+   */
+  explicit BasicGatherWriter(std::size_t threshold = 512)
+    : BasicWriter<Char>(buffer_), buffer_(threshold) {}
+
+  using BasicWriter<Char>::write;
+
+  /** Formats *value* the same way as :class:`fmt::BasicWriter`. */
+  template <typename T>
+  BasicGatherWriter &operator<<(const T &value) {
+    static_cast<BasicWriter<Char>&>(*this) << value;
+    return *this;
+  }
+
+  /** Returns the total size of the output. */
+  std::size_t size() const { return buffer_.size() + buffer_.ref_size; }
+
+  /**
+    Returns the number of output segments. Copied and referenced segments
+    alternate starting with a copied one and some of them may be empty.
+   */
+  std::size_t num_segments() const { return 2 * buffer_.refs.size() + 1; }
+
+  /** Returns the output segment with the specified index. */
+  BasicStringRef<Char> segment(std::size_t index) const {
+    std::size_t ref_index = index / 2;
+    if (index % 2 != 0) {
+      const Ref &ref = buffer_.refs[ref_index];
+      return BasicStringRef<Char>(ref.data, ref.size);
+    }
+    std::size_t start = ref_index != 0 ? buffer_.refs[ref_index - 1].pos : 0;
+    std::size_t end = ref_index < buffer_.refs.size() ?
+          buffer_.refs[ref_index].pos : buffer_.size();
+    return BasicStringRef<Char>(&buffer_[0] + start, end - start);
+  }
+
+  /** Returns the output as an ``std::string``. */
+  std::basic_string<Char> str() const {
+    std::basic_string<Char> s;
+    s.reserve(size());
+    for (std::size_t i = 0, n = num_segments(); i < n; ++i) {
+      BasicStringRef<Char> seg = segment(i);
+      s.append(seg.c_str(), seg.size());
+    }
+    return s;
+  }
+
+  /**
+    Returns a mark of the current end of the output that can be passed to
+    :func:`rollback()`.
+   */
+  std::size_t mark() const FMT_NOEXCEPT { return size(); }
+
+  /** Discards the output written after *mark*. */
+  void rollback(std::size_t mark) FMT_NOEXCEPT;
+
+  /** Discards all output. */
+  void clear() FMT_NOEXCEPT {
+    buffer_.clear();
+    buffer_.refs.clear();
+    buffer_.ref_size = 0;
+  }
+};
+
+template <typename Char>
+void BasicGatherWriter<Char>::rollback(std::size_t mark) FMT_NOEXCEPT {
+  if (mark >= size())
+    return;
+  std::size_t num_refs = buffer_.refs.size();
+  for (; num_refs != 0; --num_refs) {
+    Ref &ref = buffer_.refs[num_refs - 1];
+    std::size_t start = ref.pos + buffer_.ref_size - ref.size;
+    if (start + ref.size <= mark)
+      break;
+    if (start < mark) {
+      // Keep the part of the reference before the mark.
+      buffer_.ref_size -= ref.size - (mark - start);
+      ref.size = mark - start;
+      buffer_.refs.resize(num_refs);
+      buffer_.resize(ref.pos);
+      return;
+    }
+    buffer_.ref_size -= ref.size;
+  }
+  buffer_.refs.resize(num_refs);
+  buffer_.resize(mark - buffer_.ref_size);
+}
+
+typedef BasicGatherWriter<char> GatherWriter;
+#if FMT_USE_WCHAR
+typedef BasicGatherWriter<wchar_t> WGatherWriter;
+#endif
+
+/**
+  \rst
+  A memory writer for the Prometheus text exposition format. The metric
+  name and escaped labels of each series are formatted once by
+  :func:`add_series()` into a prefix which is then copied into the output
+  for every sample. Integer values are written with the usual integer
+  formatting. Floating-point values are written without calling the C
+  library in the shortest fixed-point form that converts back to the same
+  value, such as ``0.25``, if the value is *n* / 10\ :sup:`k` for an
+  integer *n* below 2\ :sup:`53`. Other values are written in the shortest
+  ``%g`` form that converts back to the same value.
+
+  You can use one of the following typedefs for common character types
+  and the standard allocator:
+
+  +----------------+------------------------------------------------------+
+  | Type           | Definition                                           |
+  +================+======================================================+
+  | MetricsWriter  | BasicMetricsWriter<char, std::allocator<char>>       |
+  +----------------+------------------------------------------------------+
+  | WMetricsWriter | BasicMetricsWriter<wchar_t, std::allocator<wchar_t>> |
+  +----------------+------------------------------------------------------+
+
+  **Example**::
+
+     fmt::MetricsWriter out;
+     fmt::MetricsWriter::Series get =
+         out.add_series("http_requests_total", "method", "GET");
+     fmt::MetricsWriter::Series latency = out.add_series("latency_seconds");
+     // For every scrape:
+     out.clear();
+     out.write_header("http_requests_total", "counter", "Total requests.");
+     out.sample(get, 1027);
+     out.write_header("latency_seconds", "gauge");
+     out.sample(latency, 0.25);
+
+  This writes the following output:
+
+  .. code-block:: none
+
+     # HELP http_requests_total Total requests.
+     # TYPE http_requests_total counter
+     http_requests_total{method="GET"} 1027
+     # TYPE latency_seconds gauge
+     latency_seconds 0.25
+
+  The allocator is used for both the output and the series prefixes.
+  \endrst
+ */
+template <typename Char, typename Allocator = std::allocator<Char> >
+class BasicMetricsWriter : public BasicMemoryWriter<Char, Allocator> {
+ public:
+  /** A handle of a series prefix. */
+  struct Series {
+    std::size_t offset;
+    std::size_t size;
+  };
+
+ private:
+  typedef BasicStringRef<Char> StringRef;
+
+  internal::MemoryBuffer<Char, internal::INLINE_BUFFER_SIZE, Allocator>
+    prefixes_;
+
+  // Appends s to the prefixes escaping backslashes, newlines and,
+  // if quote is true, double quotes.
+  void append_escaped(StringRef s, bool quote);
+
+  void append(StringRef s) {
+    prefixes_.append(s.c_str(), s.c_str() + s.size());
+  }
+
+  void write_value(double value);
+  void write_value(float value) { write_value(static_cast<double>(value)); }
+
+  template <typename T>
+  void write_value(T value) { *this << value; }
+
+ public:
+  explicit BasicMetricsWriter(const Allocator& alloc = Allocator())
+    : BasicMemoryWriter<Char, Allocator>(alloc), prefixes_(alloc) {}
+
+  /**
+    Adds a series with the metric name *name* and *num_labels* labels.
+    *labels* points to label names and values interleaved.
+   */
+  Series add_series(StringRef name,
+                    const StringRef *labels, std::size_t num_labels);
+
+  /** Adds a series without labels. */
+  Series add_series(StringRef name) { return add_series(name, 0, 0); }
+
+  /** Adds a series with a single label. */
+  Series add_series(StringRef name, StringRef label, StringRef value) {
+    StringRef labels[] = {label, value};
+    return add_series(name, labels, 1);
+  }
+
+  /** Adds a series with two labels. */
+  Series add_series(StringRef name, StringRef label1, StringRef value1,
+                    StringRef label2, StringRef value2) {
+    StringRef labels[] = {label1, value1, label2, value2};
+    return add_series(name, labels, 2);
+  }
+
+  /** Returns the prefix of the series *s*. */
+  StringRef prefix(Series s) const {
+    return StringRef(&prefixes_[0] + s.offset, s.size);
+  }
+
+  /**
+    Writes the ``# HELP`` line if *help* is not empty and the ``# TYPE``
+    line of the metric family *name*.
+   */
+  void write_header(StringRef name, StringRef type,
+                    StringRef help = StringRef(0, 0));
+
+  /** Writes a sample of the series *s*. */
+  template <typename T>
+  void sample(Series s, T value) {
+    *this << prefix(s);
+    write_value(value);
+    *this << '\n';
+  }
+
+  /**
+    Writes a sample of the series *s* with a timestamp in milliseconds
+    since the epoch.
+   */
+  template <typename T>
+  void sample(Series s, T value, LongLong timestamp) {
+    *this << prefix(s);
+    write_value(value);
+    *this << ' ' << timestamp << '\n';
+  }
+
+  /** Removes all series invalidating their handles. */
+  void clear_series() FMT_NOEXCEPT { prefixes_.clear(); }
+};
+
+template <typename Char, typename Allocator>
+void BasicMetricsWriter<Char, Allocator>::append_escaped(
+    StringRef s, bool quote) {
+  const Char *p = s.c_str(), *end = p + s.size();
+  for (const Char *start = p; ; ++p) {
+    if (p != end && *p != '\\' && *p != '\n' && (!quote || *p != '"'))
+      continue;
+    prefixes_.append(start, p);
+    if (p == end)
+      break;
+    prefixes_.push_back('\\');
+    prefixes_.push_back(*p == '\n' ? static_cast<Char>('n') : *p);
+    start = p + 1;
+  }
+}
+
+template <typename Char, typename Allocator>
+typename BasicMetricsWriter<Char, Allocator>::Series
+    BasicMetricsWriter<Char, Allocator>::add_series(
+      StringRef name, const StringRef *labels, std::size_t num_labels) {
+  std::size_t offset = prefixes_.size();
+  append(name);
+  for (std::size_t i = 0; i < num_labels; ++i) {
+    prefixes_.push_back(i == 0 ? '{' : ',');
+    append(labels[2 * i]);
+    prefixes_.push_back('=');
+    prefixes_.push_back('"');
+    append_escaped(labels[2 * i + 1], true);
+    prefixes_.push_back('"');
+  }
+  if (num_labels != 0)
+    prefixes_.push_back('}');
+  prefixes_.push_back(' ');
+  Series s = {offset, prefixes_.size() - offset};
+  return s;
+}
+
+template <typename Char, typename Allocator>
+void BasicMetricsWriter<Char, Allocator>::write_header(
+    StringRef name, StringRef type, StringRef help) {
+  static const Char HELP[] = {'#', ' ', 'H', 'E', 'L', 'P', ' '};
+  static const Char TYPE[] = {'#', ' ', 'T', 'Y', 'P', 'E', ' '};
+  if (help.size() != 0) {
+    // Escape the help text in the prefix buffer to avoid a temporary.
+    std::size_t offset = prefixes_.size();
+    append_escaped(help, false);
+    *this << StringRef(HELP, sizeof(HELP) / sizeof(*HELP)) << name << ' '
+          << StringRef(&prefixes_[0] + offset, prefixes_.size() - offset)
+          << '\n';
+    prefixes_.resize(offset);
+  }
+  *this << StringRef(TYPE, sizeof(TYPE) / sizeof(*TYPE)) << name << ' '
+        << type << '\n';
+}
+
+typedef BasicMetricsWriter<char> MetricsWriter;
+#if FMT_USE_WCHAR
+typedef BasicMetricsWriter<wchar_t> WMetricsWriter;
+#endif
 
 /**
   \rst
@@ -2288,7 +3668,134 @@ class BasicArrayWriter : public BasicWriter<Char> {
 };
 
 typedef BasicArrayWriter<char> ArrayWriter;
+#if FMT_USE_WCHAR
 typedef BasicArrayWriter<wchar_t> WArrayWriter;
+#endif
+
+/**
+  \rst
+  The output of a :class:`fmt::BasicParsedFormat` retained between calls to
+  :func:`render()` which re-formats only the fields whose arguments have
+  changed since the previous call and patches them into the output,
+  shifting the text that follows a field only if its size has changed.
+  Arguments are compared by value, strings by content and arguments of
+  user-defined types are always re-formatted. Rendering with a different
+  parsed format re-formats everything.
+
+  You can use one of the following typedefs for common character types:
+
+  +-----------------+------------------------------+
+  | Type            | Definition                   |
+  +=================+==============================+
+  | RenderedFormat  | BasicRenderedFormat<char>    |
+  +-----------------+------------------------------+
+  | WRenderedFormat | BasicRenderedFormat<wchar_t> |
+  +-----------------+------------------------------+
+
+  **Example**::
+
+    fmt::ParsedFormat status("cpu: {:3}% mem: {:6} MB host: {}");
+    fmt::RenderedFormat output;
+    output.render(status, cpu, mem, host);
+    ...
+    output.render(status, cpu, mem, host);  // Re-formats only cpu.
+    std::fwrite(output.data(), 1, output.size(), stdout);
+  \endrst
+ */
+template <typename Char>
+class BasicRenderedFormat {
+ private:
+  // The location of a part's output in buffer_.
+  struct Field {
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  // An argument used in the previous call to render. Strings are copied
+  // into strings_ at string_offset so that they can be compared even if
+  // the argument points to the same modified string.
+  struct Snapshot {
+    internal::Arg arg;
+    std::size_t string_offset;
+    std::size_t string_size;
+    std::size_t string_capacity;
+    bool changed;
+  };
+
+  // A field re-formatted into scratch_.
+  struct Update {
+    std::size_t part;
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  // A writer to an arbitrary buffer.
+  class BufferWriter : public BasicWriter<Char> {
+   public:
+    explicit BufferWriter(Buffer<Char> &b) : BasicWriter<Char>(b) {}
+  };
+
+  // The id of the last rendered format or 0 if the output is invalid.
+  ULongLong format_id_;
+  internal::MemoryBuffer<Char, internal::INLINE_BUFFER_SIZE> buffer_;
+  internal::MemoryBuffer<Char, internal::INLINE_BUFFER_SIZE> scratch_;
+  internal::MemoryBuffer<Field, 16> fields_;
+  internal::MemoryBuffer<Snapshot, 16> args_;
+  internal::MemoryBuffer<char, internal::INLINE_BUFFER_SIZE> strings_;
+  internal::MemoryBuffer<Update, 16> updates_;
+  std::size_t num_updated_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(BasicRenderedFormat);
+
+  // Stores arg in snapshot returning true if it differs from the stored one.
+  bool update_arg(Snapshot &snapshot, const internal::Arg &arg);
+
+  bool changed(int arg_index) const {
+    return arg_index >= 0 && args_[arg_index].changed;
+  }
+
+  // Moves unchanged fields to the offsets they have after the fields in
+  // updates_ are replaced.
+  void shift_fields();
+
+ public:
+  BasicRenderedFormat() : format_id_(0), num_updated_(0) {}
+
+  /**
+    Renders *format* with *args* re-formatting only the fields which
+    depend on changed arguments.
+   */
+  void render(const BasicParsedFormat<Char> &format, const ArgList &args);
+  FMT_VARIADIC_VOID(render, const BasicParsedFormat<Char> &)
+
+  /**
+    Returns the number of fields re-formatted by the last call to
+    :func:`render()`.
+   */
+  std::size_t num_updated_fields() const { return num_updated_; }
+
+  /**
+    Returns a pointer to the output. It is not null-terminated.
+   */
+  const Char *data() const { return &buffer_[0]; }
+
+  /**
+    Returns the output size.
+   */
+  std::size_t size() const { return buffer_.size(); }
+
+  /**
+    Returns the output as an ``std::basic_string``.
+   */
+  std::basic_string<Char> str() const {
+    return std::basic_string<Char>(&buffer_[0], buffer_.size());
+  }
+};
+
+typedef BasicRenderedFormat<char> RenderedFormat;
+#if FMT_USE_WCHAR
+typedef BasicRenderedFormat<wchar_t> WRenderedFormat;
+#endif
 
 // Formats a value.
 template <typename Char, typename T>
@@ -2379,11 +3886,33 @@ inline std::string format(StringRef format_str, ArgList args) {
   return w.str();
 }
 
+#if FMT_USE_WCHAR
 inline std::wstring format(WStringRef format_str, ArgList args) {
   WMemoryWriter w;
   w.write(format_str, args);
   return w.str();
 }
+#endif
+
+/**
+  \rst
+  Formats arguments according to a pre-parsed format string and returns
+  the result as a string.
+  \endrst
+*/
+inline std::string format(const ParsedFormat &format_str, ArgList args) {
+  MemoryWriter w;
+  w.write(format_str, args);
+  return w.str();
+}
+
+#if FMT_USE_WCHAR
+inline std::wstring format(const WParsedFormat &format_str, ArgList args) {
+  WMemoryWriter w;
+  w.write(format_str, args);
+  return w.str();
+}
+#endif
 
 /**
   \rst
@@ -2462,37 +3991,116 @@ inline int printf(StringRef format, ArgList args) {
   return fprintf(stdout, format, args);
 }
 
-/**
-  Fast integer formatter.
- */
-class FormatInt {
- private:
-  // Buffer should be large enough to hold all digits (digits10 + 1),
-  // a sign and a null character.
-  enum {BUFFER_SIZE = std::numeric_limits<ULongLong>::digits10 + 3};
-  mutable char buffer_[BUFFER_SIZE];
-  char *str_;
+namespace internal {
+
+// Emits digits of an unsigned value in a given base right to left.
+// Power-of-two bases are handled by the primary template.
+template <unsigned BASE>
+struct IntBase {
+  enum {
+    SHIFT = BASE == 2 ? 1 : BASE == 8 ? 3 : BASE == 16 ? 4 : 0,
+    MAX_DIGITS = (std::numeric_limits<ULongLong>::digits + SHIFT - 1) /
+                 (SHIFT != 0 ? SHIFT : 1)
+  };
+
+  static char *format(char *end, ULongLong value) {
+    // Invalid BASE: only 2, 8, 10 and 16 are supported.
+    typedef char BaseMustBe2_8_10Or16[SHIFT != 0 ? 1 : -1];
+    (void)sizeof(BaseMustBe2_8_10Or16);
+    do {
+      *--end = Data::HEX_DIGITS[(value & (BASE - 1)) * 2 + 1];
+    } while ((value >>= SHIFT) != 0);
+    return end;
+  }
+};
+
+template <>
+struct IntBase<16> {
+  enum { MAX_DIGITS = std::numeric_limits<ULongLong>::digits / 4 };
+
+  static char *format(char *end, ULongLong value) {
+    // Emit a byte at a time using the table of two-digit hex numbers.
+    while (value >= 0x100) {
+      unsigned index = static_cast<unsigned>(value & 0xff) * 2;
+      value >>= 8;
+      *--end = Data::HEX_DIGITS[index + 1];
+      *--end = Data::HEX_DIGITS[index];
+    }
+    unsigned index = static_cast<unsigned>(value) * 2;
+    *--end = Data::HEX_DIGITS[index + 1];
+    if (value >= 0x10)
+      *--end = Data::HEX_DIGITS[index];
+    return end;
+  }
+};
 
-  // Formats value in reverse and returns the number of digits.
-  char *format_decimal(ULongLong value) {
-    char *buffer_end = buffer_ + BUFFER_SIZE - 1;
+template <>
+struct IntBase<10> {
+  enum { MAX_DIGITS = std::numeric_limits<ULongLong>::digits10 + 1 };
+
+  static char *format(char *end, ULongLong value) {
     while (value >= 100) {
       // Integer division is slow so do it for a group of two digits instead
       // of for every digit. The idea comes from the talk by Alexandrescu
       // "Three Optimization Tips for C++". See speed-test for a comparison.
       unsigned index = (value % 100) * 2;
       value /= 100;
-      *--buffer_end = internal::Data::DIGITS[index + 1];
-      *--buffer_end = internal::Data::DIGITS[index];
+      *--end = Data::DIGITS[index + 1];
+      *--end = Data::DIGITS[index];
     }
     if (value < 10) {
-      *--buffer_end = static_cast<char>('0' + value);
-      return buffer_end;
+      *--end = static_cast<char>('0' + value);
+      return end;
     }
     unsigned index = static_cast<unsigned>(value * 2);
-    *--buffer_end = internal::Data::DIGITS[index + 1];
-    *--buffer_end = internal::Data::DIGITS[index];
-    return buffer_end;
+    *--end = Data::DIGITS[index + 1];
+    *--end = Data::DIGITS[index];
+    return end;
+  }
+};
+}  // namespace internal
+
+/**
+  \rst
+  Fast integer formatter that writes digits in base *BASE* (2, 8, 10 or 16)
+  into an internal buffer. If *WIDTH* is nonzero the output is padded with
+  zeros to at least *WIDTH* characters including the sign, as with the
+  ``{:0<WIDTH>}`` format specifier. Hexadecimal digits are lowercase and no
+  base prefix is written.
+
+  **Example**::
+
+    fmt::FormatInt(42).str();               // "42"
+    fmt::FormatHex(0xdeadbeef).str();       // "deadbeef"
+    fmt::BasicFormatInt<8>(0755).str();     // "755"
+    fmt::BasicFormatInt<10, 4>(7).str();    // "0007"
+  \endrst
+ */
+template <unsigned BASE = 10, unsigned WIDTH = 0>
+class BasicFormatInt {
+ private:
+  typedef internal::IntBase<BASE> Base;
+
+  // Buffer should be large enough to hold all digits or WIDTH characters,
+  // a sign and a null character.
+  enum {
+    MAX_SIZE = WIDTH > static_cast<unsigned>(Base::MAX_DIGITS) ?
+               WIDTH : static_cast<unsigned>(Base::MAX_DIGITS),
+    BUFFER_SIZE = MAX_SIZE + 2
+  };
+  mutable char buffer_[BUFFER_SIZE];
+  char *str_;
+
+  void FormatUnsigned(ULongLong value, bool negative = false) {
+    char *end = buffer_ + BUFFER_SIZE - 1;
+    str_ = Base::format(end, value);
+    if (WIDTH != 0) {
+      char *start = end - (WIDTH - negative);
+      while (str_ > start)
+        *--str_ = '0';
+    }
+    if (negative)
+      *--str_ = '-';
   }
 
   void FormatSigned(LongLong value) {
@@ -2500,18 +4108,16 @@ class FormatInt {
     bool negative = value < 0;
     if (negative)
       abs_value = 0 - abs_value;
-    str_ = format_decimal(abs_value);
-    if (negative)
-      *--str_ = '-';
+    FormatUnsigned(abs_value, negative);
   }
 
  public:
-  explicit FormatInt(int value) { FormatSigned(value); }
-  explicit FormatInt(long value) { FormatSigned(value); }
-  explicit FormatInt(LongLong value) { FormatSigned(value); }
-  explicit FormatInt(unsigned value) : str_(format_decimal(value)) {}
-  explicit FormatInt(unsigned long value) : str_(format_decimal(value)) {}
-  explicit FormatInt(ULongLong value) : str_(format_decimal(value)) {}
+  explicit BasicFormatInt(int value) { FormatSigned(value); }
+  explicit BasicFormatInt(long value) { FormatSigned(value); }
+  explicit BasicFormatInt(LongLong value) { FormatSigned(value); }
+  explicit BasicFormatInt(unsigned value) { FormatUnsigned(value); }
+  explicit BasicFormatInt(unsigned long value) { FormatUnsigned(value); }
+  explicit BasicFormatInt(ULongLong value) { FormatUnsigned(value); }
 
   /**
     Returns the number of characters written to the output buffer.
@@ -2539,6 +4145,134 @@ class FormatInt {
   std::string str() const { return std::string(str_, size()); }
 };
 
+typedef BasicFormatInt<> FormatInt;
+typedef BasicFormatInt<16> FormatHex;
+
+/**
+  \rst
+  Fast floating-point formatter that writes into an internal fixed-size
+  buffer without allocating memory.
+
+  **Example**::
+
+    fmt::FormatDouble shortest(0.1);        // "0.1"
+    fmt::FormatDouble fixed(0.1, 'f', 3);   // "0.100"
+    fmt::FormatDouble exp(1500.0, 'e', 2);  // "1.50e+03"
+  \endrst
+ */
+class FormatDouble {
+ public:
+  enum { MAX_PRECISION = 64 };
+
+ private:
+  // Enough for the integral digits of the largest double in fixed notation
+  // plus sign, decimal point, MAX_PRECISION fractional digits and a
+  // terminating null character.
+  enum {
+    BUFFER_SIZE = std::numeric_limits<double>::max_exponent10 +
+                  MAX_PRECISION + 5
+  };
+  char buffer_[BUFFER_SIZE];
+  std::size_t size_;
+
+  void format_shortest(double value);
+  void format(double value, char type, int precision);
+
+ public:
+  /**
+    Formats *value* using the shortest representation in ``%g`` notation
+    that converts back to the same value.
+   */
+  explicit FormatDouble(double value) { format_shortest(value); }
+
+  /**
+    Formats *value* according to the presentation *type* (one of ``'e'``,
+    ``'E'``, ``'f'``, ``'F'``, ``'g'`` and ``'G'``) with the given
+    *precision* which must not exceed ``MAX_PRECISION``.
+   */
+  FormatDouble(double value, char type, int precision = 6) {
+    format(value, type, precision);
+  }
+
+  /**
+    Returns the number of characters written to the output buffer.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+    Returns a pointer to the output buffer content. No terminating null
+    character is appended.
+   */
+  const char *data() const { return buffer_; }
+
+  /**
+    Returns a pointer to the output buffer content with terminating null
+    character appended.
+   */
+  const char *c_str() const { return buffer_; }
+
+  /**
+    Returns the content of the output buffer as an `std::string`.
+   */
+  std::string str() const { return std::string(buffer_, size_); }
+};
+
+// Defined here because it uses FormatDouble.
+template <typename Char, typename Allocator>
+void BasicMetricsWriter<Char, Allocator>::write_value(double value) {
+  if (value != value) {
+    static const Char NAN_STR[] = {'N', 'a', 'N'};
+    *this << StringRef(NAN_STR, 3);
+    return;
+  }
+  bool negative = value < 0;
+  double abs_value = negative ? -value : value;
+  // The largest double such that all integers up to it are representable.
+  const double MAX_EXACT = 9007199254740992.0;  // 2**53
+  if (abs_value > std::numeric_limits<double>::max()) {
+    static const Char INF_STR[] = {'+', 'I', 'n', 'f', '-', 'I', 'n', 'f'};
+    *this << StringRef(INF_STR + (negative ? 4 : 0), 4);
+    return;
+  }
+  static const double POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17
+  };
+  // Find the smallest number of fractional digits k such that
+  // value == n / 10**k for an integer n < 2**53. The division of exact
+  // operands is correctly rounded as is parsing of the decimal n / 10**k,
+  // so the output converts back to value.
+  for (unsigned k = 0; k < sizeof(POW10) / sizeof(*POW10); ++k) {
+    double scaled = abs_value * POW10[k];
+    if (scaled >= MAX_EXACT)
+      break;
+    double n = std::floor(scaled + 0.5);
+    if (n / POW10[k] != abs_value)
+      continue;
+    Char buffer[40];
+    Char *end = buffer + sizeof(buffer) / sizeof(*buffer), *p = end;
+    ULongLong digits = static_cast<ULongLong>(n);
+    for (unsigned i = 0; i < k; ++i, digits /= 10)
+      *--p = static_cast<Char>('0' + digits % 10);
+    if (k != 0)
+      *--p = '.';
+    do {
+      *--p = static_cast<Char>('0' + digits % 10);
+      digits /= 10;
+    } while (digits != 0);
+    if (negative)
+      *--p = '-';
+    *this << StringRef(p, static_cast<std::size_t>(end - p));
+    return;
+  }
+  FormatDouble shortest(value);
+  Char buffer[32];
+  std::size_t size = shortest.size();
+  assert(size <= sizeof(buffer) / sizeof(*buffer));
+  std::copy(shortest.data(), shortest.data() + size, buffer);
+  *this << StringRef(buffer, size);
+}
+
 // Formats a decimal integer value writing into buffer and returns
 // a pointer to the end of the formatted string. This function doesn't
 // write a terminating null character.
@@ -2563,6 +4297,161 @@ inline void format_decimal(char *&buffer, T value) {
   internal::format_decimal(buffer, abs_value, num_digits);
   buffer += num_digits;
 }
+
+#if FMT_USE_CONSTEXPR && FMT_USE_VARIADIC_TEMPLATES
+/**
+  \rst
+  A string of a fixed size *N* built at compile time. Static strings are
+  produced by :c:macro:`FMT_STATIC_INT` and :c:macro:`FMT_STATIC_STR` and
+  concatenated with each other and with string literals using ``+``.
+  This allows folding constant arguments into a format string so that only
+  the truly dynamic fields are formatted at runtime.
+
+  **Example**::
+
+    enum { MAX_USERS = 100 };
+    static constexpr auto MESSAGE =
+        "too many users: " + FMT_STATIC_INT(MAX_USERS) + " allowed, {} given";
+    std::string s = fmt::format(MESSAGE, n);
+
+  String literals are concatenated as is and therefore interpreted as a part
+  of the format string.
+  \endrst
+ */
+template <std::size_t N>
+struct StaticString {
+  // This member is public to make StaticString an aggregate which can be
+  // initialized in a constexpr function. Use c_str() to access it.
+  char data_[N + 1];
+
+  /** Returns the string size. */
+  FMT_CONSTEXPR std::size_t size() const { return N; }
+
+  /** Returns a pointer to the null-terminated string. */
+  FMT_CONSTEXPR const char *c_str() const { return data_; }
+
+  operator StringRef() const { return StringRef(data_, N); }
+};
+
+namespace internal {
+
+template <std::size_t... I>
+struct IndexSequence {};
+
+template <std::size_t N, std::size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <std::size_t... I>
+struct MakeIndexSequence<0, I...> : IndexSequence<I...> {};
+
+// Returns the number of decimal digits in n. Unlike count_digits this
+// function doesn't use lookup tables so it can be evaluated at compile time.
+FMT_CONSTEXPR unsigned static_count_digits(ULongLong n) {
+  return n < 10 ? 1 : n < 100 ? 2 : n < 1000 ? 3 : n < 10000 ? 4 :
+      4 + static_count_digits(n / 10000u);
+}
+
+template <typename T>
+FMT_CONSTEXPR bool static_is_negative(T value) { return value < T(); }
+
+template <typename T>
+FMT_CONSTEXPR ULongLong static_abs(T value) {
+  return static_is_negative(value) ?
+      0 - static_cast<ULongLong>(value) : static_cast<ULongLong>(value);
+}
+
+// Returns the size of the decimal representation of value including sign.
+template <typename T>
+FMT_CONSTEXPR std::size_t static_decimal_size(T value) {
+  return static_count_digits(static_abs(value)) +
+      (static_is_negative(value) ? 1 : 0);
+}
+
+// Returns the digit of n at the position counted from the right.
+FMT_CONSTEXPR char static_digit(ULongLong n, std::size_t pos) {
+  return pos == 0 ?
+      static_cast<char>('0' + n % 10) : static_digit(n / 10, pos - 1);
+}
+
+template <typename T>
+FMT_CONSTEXPR char static_decimal_char(T value, std::size_t size,
+                                       std::size_t index) {
+  return static_is_negative(value) && index == 0 ?
+      '-' : static_digit(static_abs(value), size - index - 1);
+}
+
+template <typename T, T VALUE, std::size_t... I>
+FMT_CONSTEXPR StaticString<sizeof...(I)>
+    static_format_decimal(IndexSequence<I...>) {
+  return {{static_decimal_char(VALUE, sizeof...(I), I)..., '\0'}};
+}
+
+// A compile-time counterpart of format_decimal that returns the decimal
+// representation of VALUE as a StaticString.
+template <typename T, T VALUE>
+FMT_CONSTEXPR StaticString<static_decimal_size(VALUE)> static_format_decimal() {
+  return static_format_decimal<T, VALUE>(
+      MakeIndexSequence<static_decimal_size(VALUE)>());
+}
+
+FMT_CONSTEXPR bool is_brace(char c) { return c == '{' || c == '}'; }
+
+// Returns the size of s with braces doubled.
+FMT_CONSTEXPR std::size_t static_escaped_size(const char *s) {
+  return *s ? (is_brace(*s) ? 2 : 1) + static_escaped_size(s + 1) : 0;
+}
+
+// Returns the character at index in s with braces doubled.
+FMT_CONSTEXPR char static_escaped_char(const char *s, std::size_t index) {
+  return is_brace(*s) ?
+        (index < 2 ? *s : static_escaped_char(s + 1, index - 2)) :
+        (index == 0 ? *s : static_escaped_char(s + 1, index - 1));
+}
+
+template <std::size_t... I>
+FMT_CONSTEXPR StaticString<sizeof...(I)> static_escape(
+    const char *s, IndexSequence<I...>) {
+  return {{static_escaped_char(s, I)..., '\0'}};
+}
+
+// Handles the empty string separately because s is unused when the index
+// sequence is empty.
+FMT_CONSTEXPR StaticString<0> static_escape(const char *, IndexSequence<>) {
+  return {{'\0'}};
+}
+
+template <std::size_t... I, std::size_t... J>
+FMT_CONSTEXPR StaticString<sizeof...(I) + sizeof...(J)> static_concat(
+    const char *lhs, IndexSequence<I...>,
+    const char *rhs, IndexSequence<J...>) {
+  return {{lhs[I]..., rhs[J]..., '\0'}};
+}
+}  // namespace internal
+
+template <std::size_t N, std::size_t M>
+FMT_CONSTEXPR StaticString<N + M> operator+(
+    const StaticString<N> &lhs, const StaticString<M> &rhs) {
+  return internal::static_concat(
+      lhs.data_, internal::MakeIndexSequence<N>(),
+      rhs.data_, internal::MakeIndexSequence<M>());
+}
+
+template <std::size_t N, std::size_t M>
+FMT_CONSTEXPR StaticString<N + M - 1> operator+(
+    const StaticString<N> &lhs, const char (&rhs)[M]) {
+  return internal::static_concat(
+      lhs.data_, internal::MakeIndexSequence<N>(),
+      rhs, internal::MakeIndexSequence<M - 1>());
+}
+
+template <std::size_t N, std::size_t M>
+FMT_CONSTEXPR StaticString<N - 1 + M> operator+(
+    const char (&lhs)[N], const StaticString<M> &rhs) {
+  return internal::static_concat(
+      lhs, internal::MakeIndexSequence<N - 1>(),
+      rhs.data_, internal::MakeIndexSequence<M>());
+}
+#endif  // FMT_USE_CONSTEXPR && FMT_USE_VARIADIC_TEMPLATES
 }
 
 #if FMT_GCC_VERSION
@@ -2696,9 +4585,35 @@ struct ArgArraySize {
 #define FMT_VARIADIC_W(ReturnType, func, ...) \
   FMT_VARIADIC_(wchar_t, ReturnType, func, return func, __VA_ARGS__)
 
+#if FMT_USE_CONSTEXPR && FMT_USE_VARIADIC_TEMPLATES
+/**
+  \rst
+  Returns a :cpp:class:`fmt::StaticString` containing the decimal
+  representation of the integral constant expression *value* computed at
+  compile time.
+  \endrst
+ */
+# define FMT_STATIC_INT(value) \
+  (fmt::internal::static_format_decimal<decltype(value), (value)>())
+
+/**
+  \rst
+  Returns a :cpp:class:`fmt::StaticString` containing the constant string *s*
+  with braces escaped so that it can be folded into a format string.
+  \endrst
+ */
+# define FMT_STATIC_STR(s) \
+  (fmt::internal::static_escape((s), fmt::internal::MakeIndexSequence< \
+    fmt::internal::static_escaped_size(s)>()))
+#endif
+
 namespace fmt {
 FMT_VARIADIC(std::string, format, StringRef)
+FMT_VARIADIC(std::string, format, const ParsedFormat &)
+#if FMT_USE_WCHAR
 FMT_VARIADIC_W(std::wstring, format, WStringRef)
+FMT_VARIADIC_W(std::wstring, format, const WParsedFormat &)
+#endif
 FMT_VARIADIC(void, print, StringRef)
 FMT_VARIADIC(void, print, std::FILE *, StringRef)
 FMT_VARIADIC(void, print, std::ostream &, StringRef)
@@ -33,11 +33,26 @@
 #include "posix.h"
 
 #include <limits.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <stdexcept>
+
+#if FMT_USE_ZLIB
+# include <zlib.h>
+#endif
+
 #ifndef _WIN32
+# include <sched.h>
 # include <unistd.h>
+# include <sys/mman.h>
+# include <sys/uio.h>
+# ifdef __linux__
+#  include <fcntl.h>  // for vmsplice
+#  include <sys/ioctl.h>
+# endif
 #else
 # include <windows.h>
 # include <io.h>
@@ -180,6 +195,62 @@ std::size_t fmt::File::write(const void *buffer, std::size_t count) {
   return result;
 }
 
+std::size_t fmt::File::write(
+    const void *buffer, std::size_t count, ErrorCode &ec) FMT_NOEXCEPT {
+  RWResult result = 0;
+  FMT_RETRY(result, FMT_POSIX_CALL(write(fd_, buffer, convert_rwcount(count))));
+  if (result < 0) {
+    ec = ErrorCode(errno);
+    return 0;
+  }
+  return result;
+}
+
+void fmt::File::write(const GatherWriter &w) {
+  std::size_t num_segments = w.num_segments();
+#ifdef _WIN32
+  for (std::size_t i = 0; i < num_segments; ++i) {
+    StringRef s = w.segment(i);
+    for (std::size_t offset = 0; offset != s.size(); )
+      offset += write(s.c_str() + offset, s.size() - offset);
+  }
+#else
+  enum { MAX_SEGMENTS = 64 };
+  iovec iov[MAX_SEGMENTS];
+  // The first segment that is not fully written and the number of
+  // characters of it that are.
+  std::size_t index = 0, offset = 0;
+  while (index != num_segments) {
+    int count = 0;
+    for (std::size_t i = index; i != num_segments && count != MAX_SEGMENTS;
+         ++i) {
+      StringRef s = w.segment(i);
+      std::size_t skip = i == index ? offset : 0;
+      if (s.size() == skip)
+        continue;
+      iov[count].iov_base = const_cast<char*>(s.c_str() + skip);
+      iov[count].iov_len = s.size() - skip;
+      ++count;
+    }
+    if (count == 0)
+      break;
+    RWResult result = 0;
+    FMT_RETRY(result, FMT_POSIX_CALL(writev(fd_, iov, count)));
+    if (result < 0)
+      throw SystemError(errno, "cannot write to file");
+    std::size_t num_written = result;
+    for (; index != num_segments; ++index, offset = 0) {
+      std::size_t remaining = w.segment(index).size() - offset;
+      if (num_written < remaining) {
+        offset += num_written;
+        break;
+      }
+      num_written -= remaining;
+    }
+  }
+#endif
+}
+
 fmt::File fmt::File::dup(int fd) {
   // Don't retry as dup doesn't return EINTR.
   // http://pubs.opengroup.org/onlinepubs/009695399/functions/dup.html
@@ -238,6 +309,23 @@ fmt::BufferedFile fmt::File::fdopen(const char *mode) {
   return file;
 }
 
+#ifndef _WIN32
+fmt::File fmt::File::open_shared(fmt::StringRef name) {
+  int fd = -1;
+  FMT_RETRY(fd, shm_open(name.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR));
+  if (fd == -1)
+    throw SystemError(errno, "cannot open shared memory {}", name);
+  return File(fd);
+}
+
+void fmt::File::resize(fmt::LongLong size) {
+  int result = 0;
+  FMT_RETRY(result, ftruncate(fd_, static_cast<off_t>(size)));
+  if (result != 0)
+    throw SystemError(errno, "cannot resize file");
+}
+#endif
+
 long fmt::getpagesize() {
 #ifdef _WIN32
   SYSTEM_INFO si;
@@ -250,3 +338,815 @@ long fmt::getpagesize() {
   return size;
 #endif
 }
+
+fmt::MessageCatalog::MessageCatalog(fmt::StringRef filename)
+: data_(0), size_(0) {
+  File file(filename, File::RDONLY);
+  map(file);
+  try {
+    parse();
+  } catch (...) {
+    unmap();
+    throw;
+  }
+}
+
+void fmt::MessageCatalog::map(File &file) {
+  fmt::LongLong size = file.size();
+  if (size == 0)
+    return;
+  if (static_cast<fmt::ULongLong>(size) >
+      (std::numeric_limits<std::size_t>::max)()) {
+    throw SystemError(EFBIG, "cannot map file");
+  }
+  size_ = static_cast<std::size_t>(size);
+#ifdef _WIN32
+  data_ = new char[size_];
+  std::size_t offset = 0;
+  while (offset != size_) {
+    std::size_t count = file.read(data_ + offset, size_ - offset);
+    if (count == 0) {
+      size_ = offset;
+      break;
+    }
+    offset += count;
+  }
+#else
+  void *data = FMT_POSIX_CALL(mmap(
+        0, size_, PROT_READ, MAP_PRIVATE, file.descriptor(), 0));
+  if (data == MAP_FAILED) {
+    size_ = 0;
+    throw SystemError(errno, "cannot map file");
+  }
+  data_ = static_cast<char*>(data);
+#endif
+}
+
+void fmt::MessageCatalog::unmap() FMT_NOEXCEPT {
+  if (!data_)
+    return;
+#ifdef _WIN32
+  delete [] data_;
+#else
+  if (FMT_POSIX_CALL(munmap(data_, size_)) != 0)
+    fmt::report_system_error(errno, "cannot unmap file");
+#endif
+  data_ = 0;
+}
+
+void fmt::MessageCatalog::parse() {
+  const char *s = data_, *end = data_ + size_;
+  for (unsigned line = 1; s != end; ++line) {
+    const char *line_end =
+        static_cast<const char*>(memchr(s, '\n', end - s));
+    const char *next = line_end ? line_end + 1 : end;
+    if (!line_end)
+      line_end = end;
+    if (line_end != s && line_end[-1] == '\r')
+      --line_end;
+    if (s == line_end || *s == '#') {
+      s = next;
+      continue;
+    }
+    Entry entry = Entry();
+    const char *p = s;
+    for (; p != line_end && '0' <= *p && *p <= '9'; ++p) {
+      unsigned new_id = entry.id * 10 + (*p - '0');
+      if (new_id / 10 != entry.id)
+        throw FormatError(fmt::format("message id too big at line {}", line));
+      entry.id = new_id;
+    }
+    if (p == s || (p != line_end && *p != ' ' && *p != '\t'))
+      throw FormatError(fmt::format("invalid message id at line {}", line));
+    if (p != line_end)
+      ++p;
+    entry.first_part = parts_.size();
+    try {
+      internal::parse_format(StringRef(p, line_end - p), parts_);
+    } catch (const FormatError &e) {
+      throw FormatError(fmt::format("{} at line {}", e.what(), line));
+    }
+    entry.num_parts = parts_.size() - entry.first_part;
+    entries_.push_back(entry);
+    s = next;
+  }
+  std::sort(entries_.begin(), entries_.end());
+  for (std::size_t i = 1, n = entries_.size(); i < n; ++i) {
+    if (entries_[i].id == entries_[i - 1].id)
+      throw FormatError(fmt::format("duplicate message id {}", entries_[i].id));
+  }
+}
+
+const fmt::MessageCatalog::Entry *
+    fmt::MessageCatalog::find(unsigned id) const {
+  Entry key = Entry();
+  key.id = id;
+  std::vector<Entry>::const_iterator it =
+      std::lower_bound(entries_.begin(), entries_.end(), key);
+  return it != entries_.end() && it->id == id ? &*it : 0;
+}
+
+void fmt::MessageCatalog::write(Writer &w, unsigned id, ArgList args) const {
+  const Entry *entry = find(id);
+  if (!entry)
+    throw FormatError(fmt::format("unknown message id {}", id));
+  BasicFormatter<char>(w).format(
+        &parts_[entry->first_part], entry->num_parts, args);
+}
+
+void fmt::StdioSink::write(const char *data, std::size_t size) {
+  if (std::fwrite(data, 1, size, file_) != size)
+    throw SystemError(errno, "cannot write to file");
+}
+
+void fmt::FileSink::write(const char *data, std::size_t size) {
+  while (size != 0) {
+    std::size_t count = file_.write(data, size);
+    data += count;
+    size -= count;
+  }
+}
+
+namespace {
+enum {
+  LZ4_MIN_MATCH = 4,
+  // The last 5 bytes of a block are always literals and the last match
+  // starts at least 12 bytes before the end of the block.
+  LZ4_LAST_LITERALS = 5,
+  LZ4_MATCH_LIMIT = 12,
+  LZ4_MAX_OFFSET = 65535,
+  LZ4_HASH_BITS = 12
+};
+
+const uint32_t LZ4_MAGIC = 0x184D2204;
+const uint32_t LZ4_UNCOMPRESSED_BLOCK = 0x80000000u;
+
+// Reads a little-endian 32-bit value as required by xxHash.
+inline uint32_t read_uint32(const unsigned char *p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void write_uint32_le(char *p, uint32_t value) {
+  for (int i = 0; i < 4; ++i, value >>= 8)
+    p[i] = static_cast<char>(value & 0xff);
+}
+
+inline uint32_t rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+// Returns the xxHash32 hash with seed 0 of a sequence shorter than 16 bytes
+// used for the LZ4 frame header checksum.
+uint32_t xxhash32(const unsigned char *data, std::size_t size) {
+  const uint32_t PRIME1 = 2654435761u, PRIME2 = 2246822519u;
+  const uint32_t PRIME3 = 3266489917u, PRIME4 = 668265263u;
+  const uint32_t PRIME5 = 374761393u;
+  uint32_t h = PRIME5 + static_cast<uint32_t>(size);
+  const unsigned char *end = data + size;
+  for (; data + 4 <= end; data += 4)
+    h = rotl32(h + read_uint32(data) * PRIME3, 17) * PRIME4;
+  for (; data != end; ++data)
+    h = rotl32(h + *data * PRIME5, 11) * PRIME1;
+  h ^= h >> 15;
+  h *= PRIME2;
+  h ^= h >> 13;
+  h *= PRIME3;
+  return h ^ (h >> 16);
+}
+
+// Returns the maximum size of an LZ4 block compressed from size bytes.
+inline std::size_t lz4_bound(std::size_t size) {
+  return size + size / 255 + 16;
+}
+
+inline uint32_t lz4_hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+unsigned char *write_lz4_length(unsigned char *out, std::size_t length) {
+  for (; length >= 255; length -= 255)
+    *out++ = 255;
+  *out++ = static_cast<unsigned char>(length);
+  return out;
+}
+
+// Writes an LZ4 sequence of literals followed by a match unless
+// match_length is 0 which is the case for the last sequence of a block.
+unsigned char *write_lz4_sequence(
+    unsigned char *out, const unsigned char *literals, std::size_t num_literals,
+    std::size_t offset, std::size_t match_length) {
+  unsigned char *token = out++;
+  const std::size_t MAX_TOKEN_LENGTH = 15;
+  *token = static_cast<unsigned char>(
+        (std::min)(num_literals, MAX_TOKEN_LENGTH) << 4);
+  if (num_literals >= 15)
+    out = write_lz4_length(out, num_literals - 15);
+  out = std::copy(literals, literals + num_literals, out);
+  if (match_length == 0)
+    return out;
+  *out++ = static_cast<unsigned char>(offset & 0xff);
+  *out++ = static_cast<unsigned char>(offset >> 8);
+  std::size_t length = match_length - LZ4_MIN_MATCH;
+  *token |= static_cast<unsigned char>((std::min)(length, MAX_TOKEN_LENGTH));
+  if (length >= 15)
+    out = write_lz4_length(out, length - 15);
+  return out;
+}
+
+// Compresses a block of size bytes into out which should have room for
+// lz4_bound(size) bytes and returns the compressed size. table is a hash
+// table of 2**LZ4_HASH_BITS positions of recently seen sequences.
+std::size_t lz4_compress(const unsigned char *in, std::size_t size,
+                         unsigned char *out, uint32_t *table) {
+  std::fill(table, table + (1 << LZ4_HASH_BITS), 0);
+  unsigned char *start = out;
+  std::size_t anchor = 0;
+  if (size > LZ4_MATCH_LIMIT) {
+    std::size_t match_limit = size - LZ4_MATCH_LIMIT;
+    std::size_t end_limit = size - LZ4_LAST_LITERALS;
+    std::size_t pos = 0;
+    unsigned num_misses = 0;
+    while (pos < match_limit) {
+      uint32_t sequence = read_uint32(in + pos);
+      uint32_t &entry = table[lz4_hash(sequence)];
+      std::size_t ref = entry;
+      entry = static_cast<uint32_t>(pos);
+      if (ref >= pos || pos - ref > LZ4_MAX_OFFSET ||
+          read_uint32(in + ref) != sequence) {
+        // Skip faster through data that doesn't compress.
+        pos += 1 + (num_misses++ >> 6);
+        continue;
+      }
+      num_misses = 0;
+      // Extend the match backwards over the pending literals.
+      while (pos > anchor && ref > 0 && in[pos - 1] == in[ref - 1]) {
+        --pos;
+        --ref;
+      }
+      std::size_t length = LZ4_MIN_MATCH;
+      while (pos + length < end_limit && in[pos + length] == in[ref + length])
+        ++length;
+      out = write_lz4_sequence(
+            out, in + anchor, pos - anchor, pos - ref, length);
+      pos += length;
+      anchor = pos;
+    }
+  }
+  out = write_lz4_sequence(out, in + anchor, size - anchor, 0, 0);
+  return out - start;
+}
+}  // namespace
+
+fmt::CompressedFileSink::CompressedFileSink(
+    File &f, Method method, std::size_t block_size)
+: sink_(f), method_(method),
+  block_size_((std::max)(block_size, static_cast<std::size_t>(1))),
+  stream_(0), finished_(false) {
+  if (method == LZ4) {
+    unsigned block_size_id = 4;
+    for (block_size_ = 65536; block_size_ < block_size && block_size_id < 7;
+         block_size_ *= 4) {
+      ++block_size_id;
+    }
+    output_.resize(4 + lz4_bound(block_size_));
+    hash_table_.resize(1 << LZ4_HASH_BITS);
+    // Frame header: magic number, flags (version 01, independent blocks),
+    // block descriptor and header checksum.
+    char header[7];
+    write_uint32_le(header, LZ4_MAGIC);
+    header[4] = 0x60;
+    header[5] = static_cast<char>(block_size_id << 4);
+    header[6] = static_cast<char>(
+          (xxhash32(reinterpret_cast<unsigned char*>(header + 4), 2) >> 8) &
+          0xff);
+    sink_.write(header, sizeof(header));
+  } else {
+#if FMT_USE_ZLIB
+    z_stream *stream = new z_stream();
+    if (deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      delete stream;
+      throw std::runtime_error("cannot initialize zlib");
+    }
+    stream_ = stream;
+    output_.resize(65536);
+#else
+    throw std::runtime_error("zlib is not available");
+#endif
+  }
+  block_.reserve(block_size_);
+}
+
+fmt::CompressedFileSink::~CompressedFileSink() FMT_NOEXCEPT {
+  if (!finished_) {
+    try {
+      finish();
+    } catch (const SystemError &e) {
+      fmt::report_system_error(e.error_code(), "cannot write compressed data");
+    } catch (const std::exception &e) {
+      std::fprintf(stderr, "cannot write compressed data: %s\n", e.what());
+    } catch (...) {}
+  }
+#if FMT_USE_ZLIB
+  if (z_stream *stream = static_cast<z_stream*>(stream_)) {
+    deflateEnd(stream);
+    delete stream;
+  }
+#endif
+}
+
+void fmt::CompressedFileSink::compress(
+    const char *data, std::size_t size, Flush flush) {
+  if (method_ == LZ4) {
+    if (size == 0)
+      return;
+    std::size_t compressed_size = lz4_compress(
+          reinterpret_cast<const unsigned char*>(data), size,
+          reinterpret_cast<unsigned char*>(&output_[4]), &hash_table_[0]);
+    uint32_t block_header = static_cast<uint32_t>(compressed_size);
+    if (compressed_size >= size) {
+      block_header = static_cast<uint32_t>(size) | LZ4_UNCOMPRESSED_BLOCK;
+      std::copy(data, data + size, &output_[4]);
+      compressed_size = size;
+    }
+    write_uint32_le(&output_[0], block_header);
+    sink_.write(&output_[0], 4 + compressed_size);
+    return;
+  }
+#if FMT_USE_ZLIB
+  static const int FLUSH_MODES[] = {Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FINISH};
+  z_stream *stream = static_cast<z_stream*>(stream_);
+  stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream->avail_in = static_cast<uInt>(size);
+  do {
+    stream->next_out = reinterpret_cast<Bytef*>(&output_[0]);
+    stream->avail_out = static_cast<uInt>(output_.size());
+    if (::deflate(stream, FLUSH_MODES[flush]) == Z_STREAM_ERROR)
+      throw std::runtime_error("cannot compress data");
+    sink_.write(&output_[0], output_.size() - stream->avail_out);
+  } while (stream->avail_out == 0);
+#else
+  (void)flush;
+#endif
+}
+
+void fmt::CompressedFileSink::write(const char *data, std::size_t size) {
+  if (!block_.empty()) {
+    std::size_t count = (std::min)(size, block_size_ - block_.size());
+    block_.insert(block_.end(), data, data + count);
+    data += count;
+    size -= count;
+    if (block_.size() != block_size_)
+      return;
+    compress(&block_[0], block_size_, NO_FLUSH);
+    block_.clear();
+  }
+  // Compress whole blocks without copying them.
+  for (; size >= block_size_; data += block_size_, size -= block_size_)
+    compress(data, block_size_, NO_FLUSH);
+  block_.insert(block_.end(), data, data + size);
+}
+
+void fmt::CompressedFileSink::flush() {
+  const char *data = block_.empty() ? 0 : &block_[0];
+  compress(data, block_.size(), SYNC_FLUSH);
+  block_.clear();
+}
+
+void fmt::CompressedFileSink::finish() {
+  if (finished_)
+    return;
+  finished_ = true;
+  const char *data = block_.empty() ? 0 : &block_[0];
+  compress(data, block_.size(), FINISH);
+  block_.clear();
+  if (method_ == LZ4) {
+    char end_mark[4] = {};
+    sink_.write(end_mark, sizeof(end_mark));
+  }
+}
+
+void fmt::TeeWriter::add_sink(Sink &sink, StringRef prefix, StringRef suffix) {
+  Output output;
+  output.sink = &sink;
+  output.prefix = prefix;
+  output.suffix = suffix;
+  outputs_.push_back(output);
+}
+
+void fmt::TeeWriter::add_sink(Sink &sink, Color c) {
+  char escape[] = "\x1b[30m";
+  escape[3] = '0' + static_cast<char>(c);
+  add_sink(sink, escape, "\x1b[0m");
+}
+
+void fmt::TeeWriter::print(StringRef format_str, ArgList args) {
+  payload_.clear();
+  payload_.write(format_str, args);
+  for (std::size_t i = 0, n = outputs_.size(); i < n; ++i) {
+    const Output &output = outputs_[i];
+    if (output.prefix.empty() && output.suffix.empty()) {
+      output.sink->write(payload_.data(), payload_.size());
+      continue;
+    }
+    decorated_.clear();
+    decorated_ << output.prefix;
+    decorated_ << StringRef(payload_.data(), payload_.size());
+    decorated_ << output.suffix;
+    output.sink->write(decorated_.data(), decorated_.size());
+  }
+}
+
+bool fmt::NonBlockingWriter::flush() {
+  while (start_ != buffer_.size()) {
+    ErrorCode ec;
+    std::size_t count =
+        file_.write(&buffer_[start_], buffer_.size() - start_, ec);
+    if (ec.get() == EAGAIN || ec.get() == EWOULDBLOCK)
+      break;
+    if (ec.get() != 0)
+      throw SystemError(ec.get(), "cannot write to file");
+    start_ += count;
+  }
+  std::size_t num_pending = pending();
+  if (num_pending == 0) {
+    clear();
+    return true;
+  }
+  // Discard the written output once it is at least as large as the pending
+  // one, so that the pending output is moved a bounded number of times.
+  if (start_ >= num_pending) {
+    memmove(&buffer_[0], &buffer_[start_], num_pending);
+    buffer_.resize(num_pending);
+    start_ = 0;
+  }
+  return false;
+}
+
+#ifdef __linux__
+fmt::PipeWriter::PipeWriter(File &f, std::size_t chunk_size)
+: Writer(buffer_), file_(f), buffer_(*this), current_(0),
+  chunk_size_(chunk_size), page_size_(fmt::getpagesize()), num_gifted_(0) {
+  chunks_.push_back(map_chunk(chunk_size));
+  // Round the chunk size up to a whole number of pages.
+  chunk_size_ = chunks_[0].capacity;
+  buffer_.set(chunks_[0], 0);
+}
+
+fmt::PipeWriter::~PipeWriter() FMT_NOEXCEPT {
+  // Unmapping is safe even if the pipe still holds some of the pages
+  // because it keeps references to them.
+  for (std::size_t i = 0, n = chunks_.size(); i < n; ++i) {
+    if (FMT_POSIX_CALL(munmap(chunks_[i].data, chunks_[i].capacity)) != 0)
+      fmt::report_system_error(errno, "cannot unmap memory");
+  }
+}
+
+fmt::PipeWriter::Chunk fmt::PipeWriter::map_chunk(std::size_t size) const {
+  Chunk chunk = Chunk();
+  chunk.capacity = (size + page_size_ - 1) / page_size_ * page_size_;
+  if (chunk.capacity == 0)
+    chunk.capacity = page_size_;
+  void *data = FMT_POSIX_CALL(mmap(0, chunk.capacity, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (data == MAP_FAILED)
+    throw SystemError(errno, "cannot map memory");
+  chunk.data = static_cast<char*>(data);
+  return chunk;
+}
+
+void fmt::PipeWriter::grow(std::size_t size) {
+  Chunk &chunk = chunks_[current_];
+  Chunk new_chunk = map_chunk((std::max)(size, 2 * chunk.capacity));
+  std::size_t num_chars = buffer_.size();
+  std::copy(chunk.data, chunk.data + num_chars, new_chunk.data);
+  // The chunk can be unmapped because its pages are not in the pipe.
+  FMT_POSIX_CALL(munmap(chunk.data, chunk.capacity));
+  chunk = new_chunk;
+  buffer_.set(chunk, num_chars);
+}
+
+void fmt::PipeWriter::splice(std::size_t size) {
+  Chunk &chunk = chunks_[current_];
+  for (std::size_t offset = 0; offset != size; ) {
+    iovec iov = {chunk.data + offset, size - offset};
+    ssize_t result = 0;
+    FMT_RETRY(result,
+              vmsplice(file_.descriptor(), &iov, 1, SPLICE_F_GIFT));
+    if (result < 0)
+      throw SystemError(errno, "cannot write to pipe");
+    offset += result;
+  }
+  num_gifted_ += size;
+  chunk.end = num_gifted_;
+
+  // Find a chunk with all its data consumed by the reader.
+  int num_unread = 0;
+  if (ioctl(file_.descriptor(), FIONREAD, &num_unread) != 0)
+    throw SystemError(errno, "cannot get pipe size");
+  ULongLong num_consumed = num_gifted_ - num_unread;
+  std::size_t num_chars = buffer_.size() - size;
+  std::size_t next = 0, num_chunks = chunks_.size();
+  for (; next != num_chunks; ++next) {
+    const Chunk &c = chunks_[next];
+    if (c.end <= num_consumed && c.capacity >= num_chars && next != current_)
+      break;
+  }
+  if (next == num_chunks)
+    chunks_.push_back(map_chunk((std::max)(chunk_size_, num_chars)));
+  const Chunk &old_chunk = chunks_[current_];
+  const Chunk &new_chunk = chunks_[next];
+  std::copy(old_chunk.data + size, old_chunk.data + size + num_chars,
+            new_chunk.data);
+  current_ = next;
+  buffer_.set(new_chunk, num_chars);
+}
+
+void fmt::PipeWriter::print(StringRef format_str, ArgList args) {
+  write(format_str, args);
+  std::size_t size = buffer_.size();
+  if (size >= chunk_size_)
+    splice(size - size % page_size_);
+}
+
+void fmt::PipeWriter::flush() {
+  if (buffer_.size() != 0)
+    splice(buffer_.size());
+}
+#endif  // __linux__
+
+#ifndef _WIN32
+namespace {
+// Atomic operations on memory shared between processes.
+#ifdef __ATOMIC_ACQUIRE
+template <typename T>
+inline T load_acquire(T *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+template <typename T>
+inline void store_release(T *p, T value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+inline bool compare_and_swap(T *p, T expected, T desired) {
+  return __atomic_compare_exchange_n(
+        p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+inline void fetch_add(T *p, T value) {
+  __atomic_fetch_add(p, value, __ATOMIC_RELAXED);
+}
+#else
+// The legacy builtins are full barriers. Loads and stores use
+// read-modify-write operations because 64-bit loads and stores
+// are not atomic on some 32-bit platforms.
+template <typename T>
+inline T load_acquire(T *p) { return __sync_fetch_and_add(p, 0); }
+
+template <typename T>
+inline bool compare_and_swap(T *p, T expected, T desired) {
+  return __sync_bool_compare_and_swap(p, expected, desired);
+}
+
+template <typename T>
+inline void store_release(T *p, T value) {
+  T old = *p;
+  while (!compare_and_swap(p, old, value))
+    old = *p;
+}
+
+template <typename T>
+inline void fetch_add(T *p, T value) { __sync_fetch_and_add(p, value); }
+#endif
+
+enum { CACHE_LINE_SIZE = 64 };
+
+// States of a log ring. The ring is ready when the state is equal to
+// LOG_RING_MAGIC which also identifies the file format.
+const uint32_t LOG_RING_INITIALIZING = 1;
+const uint32_t LOG_RING_MAGIC = 0x676f6c66;  // "flog" in little endian
+
+// Record flags.
+enum { RECORD_TRUNCATED = 1, RECORD_ABORTED = 2 };
+
+// A buffer that stores the output in a slot. The output that doesn't fit
+// into the slot is moved to a buffer on the heap and is truncated when
+// the record is committed.
+class SlotBuffer : public fmt::Buffer<char> {
+ private:
+  char *slot_data_;
+  std::size_t slot_capacity_;
+  std::vector<char> overflow_;
+
+ protected:
+  void grow(std::size_t size) {
+    std::vector<char> data((std::max)(size, 2 * capacity_));
+    std::copy(ptr_, ptr_ + size_, data.begin());
+    overflow_.swap(data);
+    ptr_ = &overflow_[0];
+    capacity_ = overflow_.size();
+  }
+
+ public:
+  SlotBuffer(char *data, std::size_t capacity)
+  : fmt::Buffer<char>(data, capacity), slot_data_(data),
+    slot_capacity_(capacity) {}
+
+  bool truncated() const { return ptr_ != slot_data_; }
+
+  // Copies the part of the output that fits into the slot from the heap
+  // and returns its size.
+  std::size_t commit() {
+    if (!truncated())
+      return size_;
+    std::copy(ptr_, ptr_ + slot_capacity_, slot_data_);
+    return slot_capacity_;
+  }
+};
+
+// A writer that formats a record into a slot.
+class SlotWriter : public fmt::Writer {
+ private:
+  SlotBuffer buffer_;
+
+ public:
+  SlotWriter(char *data, std::size_t capacity)
+  : fmt::Writer(buffer_), buffer_(data, capacity) {}
+
+  SlotBuffer &buffer() { return buffer_; }
+};
+}
+
+struct fmt::LogRing::Header {
+  uint32_t state;
+  uint32_t num_slots;
+  uint32_t slot_size;
+  char pad0[CACHE_LINE_SIZE - 12];
+  // The position of the next slot to be claimed by a producer.
+  uint64_t write_pos;
+  uint64_t num_dropped;
+  char pad1[CACHE_LINE_SIZE - 16];
+  // The position of the next record to be read by the collector.
+  uint64_t read_pos;
+  char pad2[CACHE_LINE_SIZE - 8];
+};
+
+// A slot header followed by the record data. A slot at position pos
+// is free if seq == pos and contains a committed record if seq == pos + 1.
+// When the record is read, seq is advanced by the number of slots which
+// frees the slot for the next round.
+struct fmt::LogRing::Slot {
+  uint64_t seq;
+  uint32_t size;
+  uint32_t flags;
+};
+
+fmt::LogRing::Slot *fmt::LogRing::slot(uint64_t pos) const {
+  return reinterpret_cast<Slot*>(
+        slots_ + static_cast<std::size_t>(pos & mask_) * slot_size_);
+}
+
+fmt::LogRing::LogRing(File &f, unsigned num_slots, std::size_t slot_size)
+: header_(0), slots_(0), size_(0), slot_size_(0), mask_(0) {
+  uint32_t n = 1;
+  while (n < num_slots && n < 0x80000000u)
+    n <<= 1;
+  slot_size = ((std::max)(slot_size, sizeof(Slot) + 8) + 7) / 8 * 8;
+  ULongLong required_size = sizeof(Header) +
+      static_cast<ULongLong>(n) * slot_size;
+  if (f.size() == 0)
+    f.resize(static_cast<LongLong>(required_size));
+  LongLong file_size = f.size();
+  if (static_cast<ULongLong>(file_size) >
+      (std::numeric_limits<std::size_t>::max)()) {
+    throw SystemError(EFBIG, "cannot map file");
+  }
+  size_ = static_cast<std::size_t>(file_size);
+  if (size_ < sizeof(Header))
+    throw SystemError(EINVAL, "invalid log ring");
+  void *data = FMT_POSIX_CALL(mmap(
+        0, size_, PROT_READ | PROT_WRITE, MAP_SHARED, f.descriptor(), 0));
+  if (data == MAP_FAILED)
+    throw SystemError(errno, "cannot map file");
+  header_ = static_cast<Header*>(data);
+  slots_ = static_cast<char*>(data) + sizeof(Header);
+
+  if (compare_and_swap(&header_->state, 0u, LOG_RING_INITIALIZING)) {
+    if (size_ >= required_size) {
+      header_->num_slots = n;
+      header_->slot_size = static_cast<uint32_t>(slot_size);
+      header_->write_pos = header_->num_dropped = header_->read_pos = 0;
+      slot_size_ = slot_size;
+      mask_ = n - 1;
+      for (uint32_t i = 0; i != n; ++i)
+        slot(i)->seq = i;
+      store_release(&header_->state, LOG_RING_MAGIC);
+    } else {
+      // The file has been created with different parameters.
+      store_release(&header_->state, 0u);
+    }
+  } else {
+    // Wait for the process that creates the ring to initialize it.
+    while (load_acquire(&header_->state) == LOG_RING_INITIALIZING)
+      sched_yield();
+  }
+
+  n = header_->num_slots;
+  slot_size = header_->slot_size;
+  if (header_->state != LOG_RING_MAGIC || n == 0 || (n & (n - 1)) != 0 ||
+      slot_size < sizeof(Slot) + 8 || slot_size % 8 != 0 ||
+      sizeof(Header) + static_cast<ULongLong>(n) * slot_size > size_) {
+    FMT_POSIX_CALL(munmap(data, size_));
+    throw SystemError(EINVAL, "invalid log ring");
+  }
+  slot_size_ = slot_size;
+  mask_ = n - 1;
+}
+
+fmt::LogRing::~LogRing() FMT_NOEXCEPT {
+  if (FMT_POSIX_CALL(munmap(header_, size_)) != 0)
+    fmt::report_system_error(errno, "cannot unmap file");
+}
+
+std::size_t fmt::LogRing::max_record_size() const {
+  return slot_size_ - sizeof(Slot);
+}
+
+fmt::ULongLong fmt::LogRing::num_dropped() const {
+  return load_acquire(&header_->num_dropped);
+}
+
+bool fmt::LogRing::print(StringRef format_str, ArgList args) {
+  // Claim a slot.
+  uint64_t pos = load_acquire(&header_->write_pos);
+  Slot *s = 0;
+  for (;;) {
+    s = slot(pos);
+    uint64_t seq = load_acquire(&s->seq);
+    if (seq == pos) {
+      if (compare_and_swap(&header_->write_pos, pos, pos + 1))
+        break;
+    } else if (seq < pos) {
+      // The slot holds a record from the previous round, so the ring is full.
+      fetch_add(&header_->num_dropped, static_cast<uint64_t>(1));
+      return false;
+    }
+    pos = load_acquire(&header_->write_pos);
+  }
+
+  SlotWriter w(reinterpret_cast<char*>(s + 1), max_record_size());
+  try {
+    w.write(format_str, args);
+  } catch (...) {
+    // Commit an empty record that is skipped by the reader, so that the
+    // ring doesn't stall.
+    s->size = 0;
+    s->flags = RECORD_ABORTED;
+    compare_and_swap(&s->seq, pos, pos + 1);
+    throw;
+  }
+  SlotBuffer &buffer = w.buffer();
+  s->flags = buffer.truncated() ? RECORD_TRUNCATED : 0;
+  s->size = static_cast<uint32_t>(buffer.commit());
+  // The commit fails if the collector has skipped the record.
+  if (!compare_and_swap(&s->seq, pos, pos + 1)) {
+    fetch_add(&header_->num_dropped, static_cast<uint64_t>(1));
+    return false;
+  }
+  return true;
+}
+
+bool fmt::LogRing::read(Writer &w, bool *truncated) {
+  for (;;) {
+    uint64_t pos = load_acquire(&header_->read_pos);
+    Slot *s = slot(pos);
+    if (load_acquire(&s->seq) != pos + 1)
+      return false;
+    uint32_t flags = s->flags;
+    bool aborted = (flags & RECORD_ABORTED) != 0;
+    if (!aborted) {
+      std::size_t size = (std::min)(
+            static_cast<std::size_t>(s->size), max_record_size());
+      w << StringRef(reinterpret_cast<const char*>(s + 1), size);
+      if (truncated)
+        *truncated = (flags & RECORD_TRUNCATED) != 0;
+    }
+    store_release(&s->seq, pos + mask_ + 1);
+    store_release(&header_->read_pos, pos + 1);
+    if (!aborted)
+      return true;
+  }
+}
+
+bool fmt::LogRing::skip() {
+  uint64_t pos = load_acquire(&header_->read_pos);
+  // Check that the slot has been claimed.
+  if (load_acquire(&header_->write_pos) <= pos)
+    return false;
+  if (!compare_and_swap(&slot(pos)->seq, pos, pos + mask_ + 1))
+    return false;
+  store_release(&header_->read_pos, pos + 1);
+  return true;
+}
+#endif  // _WIN32
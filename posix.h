@@ -38,6 +38,7 @@
 #include <stdio.h>
 
 #include <cstddef>
+#include <vector>
 
 #include "format.h"
 
@@ -308,6 +309,15 @@ class File {
   // Attempts to write count bytes from the specified buffer to the file.
   std::size_t write(const void *buffer, std::size_t count);
 
+  // Attempts to write count bytes from the specified buffer to the file.
+  // On error sets ec and returns 0.
+  std::size_t write(const void *buffer, std::size_t count,
+                    ErrorCode &ec) FMT_NOEXCEPT;
+
+  // Writes the output of the gather writer to the file with a single
+  // writev call unless the file accepts only a part of it.
+  void write(const GatherWriter &w);
+
   // Duplicates a file descriptor with the dup function and returns
   // the duplicate as a file object.
   static File dup(int fd);
@@ -327,10 +337,468 @@ class File {
   // Creates a BufferedFile object associated with this file and detaches
   // this File object from the file.
   BufferedFile fdopen(const char *mode);
+
+#ifndef _WIN32
+  // Opens a POSIX shared memory object with the given name for reading and
+  // writing creating it if it doesn't exist. The name should start with '/'.
+  static File open_shared(fmt::StringRef name);
+
+  // Truncates or extends the file to the specified size.
+  void resize(fmt::LongLong size);
+#endif
 };
 
 // Returns the memory page size.
 long getpagesize();
+
+// A catalog of message templates loaded from a file. Each line of the file
+// has the form "<id> <template>" where <id> is a nonnegative integer and
+// <template> is a format string. Empty lines and lines starting with '#'
+// are ignored. The file is mapped into memory and all templates are parsed
+// once when the catalog is loaded, so formatting a message by id neither
+// copies nor parses its template. Methods may throw fmt::SystemError if
+// the file cannot be read and fmt::FormatError if it is malformed.
+class MessageCatalog {
+ private:
+  // File content. Templates are not copied and point into it.
+  char *data_;
+  std::size_t size_;
+
+  // A message id and the range of its template parts in parts_.
+  struct Entry {
+    unsigned id;
+    std::size_t first_part;
+    std::size_t num_parts;
+
+    bool operator<(const Entry &other) const { return id < other.id; }
+  };
+
+  std::vector<Entry> entries_;  // Sorted by id.
+  internal::MemoryBuffer<internal::FormatPart<char>, 16> parts_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(MessageCatalog);
+
+  void map(File &file);
+  void unmap() FMT_NOEXCEPT;
+
+  // Parses the file content filling entries_ and parts_.
+  void parse();
+
+  const Entry *find(unsigned id) const;
+
+ public:
+  // Loads a message catalog from the specified file.
+  explicit MessageCatalog(fmt::StringRef filename);
+
+  ~MessageCatalog() FMT_NOEXCEPT { unmap(); }
+
+  // Returns the number of messages in the catalog.
+  std::size_t size() const { return entries_.size(); }
+
+  // Returns true if the catalog has a message with the specified id.
+  bool contains(unsigned id) const { return find(id) != 0; }
+
+  // Writes the message with the specified id formatted with args.
+  // Throws fmt::FormatError if there is no such message.
+  void write(Writer &w, unsigned id, ArgList args) const;
+};
+
+// Formats the message with the specified id from the catalog and returns
+// the result as a string.
+inline std::string format(
+    const MessageCatalog &catalog, unsigned id, ArgList args) {
+  MemoryWriter w;
+  catalog.write(w, id, args);
+  return w.str();
+}
+FMT_VARIADIC(std::string, format, const MessageCatalog &, unsigned)
+
+// A destination of formatted output.
+class Sink {
+ public:
+  virtual ~Sink() {}
+
+  // Writes size bytes from data to the sink.
+  virtual void write(const char *data, std::size_t size) = 0;
+};
+
+// A sink that writes to a FILE object.
+class StdioSink : public Sink {
+ private:
+  FILE *file_;
+
+ public:
+  explicit StdioSink(FILE *f) : file_(f) {}
+
+  void write(const char *data, std::size_t size);
+};
+
+// A sink that writes to a file descriptor.
+class FileSink : public Sink {
+ private:
+  File &file_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(FileSink);
+
+ public:
+  explicit FileSink(File &f) : file_(f) {}
+
+  // Writes all size bytes retrying partial writes.
+  void write(const char *data, std::size_t size);
+};
+
+// A sink that compresses the output block by block as it is written and
+// writes the compressed blocks to a file. With the LZ4 method the output is
+// an LZ4 frame with independent blocks compressed by the built-in
+// compressor, which can be decompressed with the lz4 tool. With the GZIP
+// method the output is a gzip stream compressed with zlib, which is only
+// available if the library is built with FMT_USE_ZLIB. The file is not
+// owned and should outlive the sink.
+//
+// Example:
+//   fmt::File f("report.txt.lz4", fmt::File::WRONLY | O_CREAT | O_TRUNC);
+//   fmt::CompressedFileSink sink(f);
+//   fmt::TeeWriter out;
+//   out.add_sink(sink);
+//   for (std::size_t i = 0; i < rows.size(); ++i)
+//     out.print("{:<20} {:>10}\n", rows[i].name, rows[i].total);
+//   sink.finish();
+class CompressedFileSink : public Sink {
+ public:
+  enum Method { LZ4, GZIP };
+
+ private:
+  FileSink sink_;
+  Method method_;
+  std::vector<char> block_;
+  std::size_t block_size_;
+  std::vector<char> output_;
+  std::vector<uint32_t> hash_table_;
+  void *stream_;  // zlib stream.
+  bool finished_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(CompressedFileSink);
+
+  enum Flush { NO_FLUSH, SYNC_FLUSH, FINISH };
+
+  // Compresses size bytes from data and writes the result to the file.
+  // With LZ4 the data is compressed into a single block.
+  void compress(const char *data, std::size_t size, Flush flush);
+
+ public:
+  // Constructs a CompressedFileSink object that writes to f compressing the
+  // output in blocks of block_size bytes. For LZ4 the block size is rounded
+  // up to one of the sizes supported by the frame format: 64 KiB, 256 KiB,
+  // 1 MiB or 4 MiB. Writes the header of the compressed stream.
+  explicit CompressedFileSink(
+      File &f, Method method = LZ4, std::size_t block_size = 65536);
+
+  // Finishes the compressed stream unless it has already been finished.
+  ~CompressedFileSink() FMT_NOEXCEPT;
+
+  void write(const char *data, std::size_t size);
+
+  // Compresses and writes the buffered output, so that the compressed
+  // stream written so far can be decompressed completely.
+  void flush();
+
+  // Flushes the output and writes the end of the compressed stream.
+  // Nothing should be written to the sink after this.
+  void finish();
+};
+
+// A sink that appends to a writer, e.g. a fmt::MemoryWriter.
+class WriterSink : public Sink {
+ private:
+  Writer &writer_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(WriterSink);
+
+ public:
+  explicit WriterSink(Writer &w) : writer_(w) {}
+
+  void write(const char *data, std::size_t size) {
+    writer_ << StringRef(data, size);
+  }
+};
+
+// A writer that formats its arguments once and sends the output to
+// several sinks, each of which can decorate it with its own prefix and
+// suffix. Every output is passed to a sink in a single write call.
+// Sinks are not owned by TeeWriter and should outlive it.
+//
+// Example:
+//   StdioSink console(stdout);
+//   FileSink log(file);
+//   fmt::TeeWriter tee;
+//   tee.add_sink(console, fmt::RED);
+//   tee.add_sink(log, "[error] ", "\n");
+//   tee.print("cannot open {}", filename);
+class TeeWriter {
+ private:
+  struct Output {
+    Sink *sink;
+    std::string prefix;
+    std::string suffix;
+  };
+  std::vector<Output> outputs_;
+
+  // Buffers reused between calls to avoid allocations.
+  MemoryWriter payload_;
+  MemoryWriter decorated_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(TeeWriter);
+
+ public:
+  TeeWriter() {}
+
+  // Adds a sink that receives the output surrounded by prefix and suffix.
+  void add_sink(Sink &sink, StringRef prefix = "", StringRef suffix = "");
+
+  // Adds a sink that receives the output in the specified color using
+  // the same terminal escape codes as print_colored.
+  void add_sink(Sink &sink, Color c);
+
+  // Returns the number of sinks.
+  std::size_t num_sinks() const { return outputs_.size(); }
+
+  // Formats args according to specifications in format_str and writes
+  // the result to all sinks.
+  void print(StringRef format_str, ArgList args);
+  FMT_VARIADIC(void, print, StringRef)
+};
+
+// A writer to a file in non-blocking mode such as a socket or a pipe
+// served by an event loop. The output is formatted into an internal queue
+// and flush() writes as much of it as the file accepts without blocking.
+// If some output is still pending, flush() should be called again when the
+// file becomes writable. The output is appended to the queue in the
+// meantime. The file is not owned and should outlive the writer.
+//
+// Example:
+//   fmt::NonBlockingWriter out(socket);
+//   out.write("HTTP/1.1 200 OK\r\nContent-Length: {}\r\n\r\n", body.size());
+//   out << body;
+//   if (!out.flush())
+//     loop.wait_writable(socket.descriptor(), on_writable);
+class NonBlockingWriter : public Writer {
+ private:
+  File &file_;
+  internal::MemoryBuffer<char, internal::INLINE_BUFFER_SIZE> buffer_;
+
+  // The start of the output that has not been written to the file.
+  std::size_t start_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(NonBlockingWriter);
+
+  // The buffer may start with output that has been written to the file.
+  using Writer::size;
+  using Writer::data;
+  using Writer::c_str;
+  using Writer::str;
+  using Writer::mark;
+
+  // Discards the pending output after mark but never the output that has
+  // been written to the file. Called through a reference to Writer.
+  void rollback(std::size_t mark) FMT_NOEXCEPT {
+    Writer::rollback(mark < start_ ? start_ : mark);
+  }
+
+ public:
+  explicit NonBlockingWriter(File &f) : Writer(buffer_), file_(f), start_(0) {}
+
+  // Returns the number of bytes that have not been written to the file.
+  std::size_t pending() const { return buffer_.size() - start_; }
+
+  // Writes the pending output until all of it is written or the write
+  // would block. Returns true if no output is pending. Throws SystemError
+  // on errors other than EAGAIN and EWOULDBLOCK.
+  bool flush();
+
+  // Discards the pending output.
+  void clear() FMT_NOEXCEPT {
+    buffer_.clear();
+    start_ = 0;
+  }
+};
+
+#ifdef __linux__
+// A writer that sends its output to a pipe without copying it into the
+// pipe buffer. The output is formatted into page-aligned chunks of memory
+// which are gifted to the pipe with vmsplice(SPLICE_F_GIFT). A chunk is
+// reused only after the reader has consumed all the data gifted from it
+// as reported by the FIONREAD ioctl. For this to be safe the reader should
+// copy the data from the pipe, e.g. with read, rather than splice it to
+// another file which keeps the pages referenced after they leave the pipe.
+// The pipe is not owned and should outlive the writer. Output that has not
+// been flushed is discarded when the writer is destroyed.
+//
+// Example:
+//   fmt::File read_end, write_end;
+//   fmt::File::pipe(read_end, write_end);
+//   // Pass read_end to a consumer process.
+//   fmt::PipeWriter out(write_end);
+//   for (std::size_t i = 0; i < records.size(); ++i)
+//     out.print("{} {}\n", records[i].key, records[i].value);
+//   out.flush();
+class PipeWriter : public Writer {
+ private:
+  // A page-aligned chunk of memory mapped with mmap.
+  struct Chunk {
+    char *data;
+    std::size_t capacity;
+    // The total number of bytes gifted to the pipe when this chunk was
+    // last gifted. The chunk can be reused once they are all consumed.
+    ULongLong end;
+  };
+
+  // A buffer that stores the output in the current chunk.
+  class ChunkBuffer : public Buffer<char> {
+   private:
+    PipeWriter &writer_;
+
+   protected:
+    void grow(std::size_t size) { writer_.grow(size); }
+
+   public:
+    explicit ChunkBuffer(PipeWriter &w) : writer_(w) {}
+
+    void set(const Chunk &chunk, std::size_t size) {
+      ptr_ = chunk.data;
+      capacity_ = chunk.capacity;
+      size_ = size;
+    }
+  };
+
+  File &file_;
+  ChunkBuffer buffer_;
+  std::vector<Chunk> chunks_;
+  std::size_t current_;  // The index of the chunk being written.
+  std::size_t chunk_size_;
+  std::size_t page_size_;
+  ULongLong num_gifted_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(PipeWriter);
+
+  // The buffer holds only the output in the current chunk which is moved
+  // to offset 0 of another chunk when gifting, so positions in it are not
+  // stable across print and flush.
+  using Writer::size;
+  using Writer::data;
+  using Writer::c_str;
+  using Writer::str;
+  using Writer::mark;
+  using Writer::rollback;
+
+  // Maps a chunk of at least size bytes.
+  Chunk map_chunk(std::size_t size) const;
+
+  // Moves the output to a larger chunk.
+  void grow(std::size_t size);
+
+  // Gifts the first size bytes of the output to the pipe and moves the
+  // rest of it to a chunk that can be reused.
+  void splice(std::size_t size);
+
+ public:
+  // Constructs a PipeWriter object that writes to f which should be the
+  // write end of a pipe gifting it the output in parts of at least
+  // chunk_size bytes when using print.
+  explicit PipeWriter(File &f, std::size_t chunk_size = 65536);
+
+  ~PipeWriter() FMT_NOEXCEPT;
+
+  // Formats args according to specifications in format_str and writes the
+  // result to the writer. Once the output exceeds the chunk size, all full
+  // pages of it are gifted to the pipe.
+  void print(StringRef format_str, ArgList args);
+  FMT_VARIADIC(void, print, StringRef)
+
+  // Gifts all output to the pipe blocking while the pipe is full.
+  void flush();
+};
+#endif  // __linux__
+
+#ifndef _WIN32
+// A lock-free ring buffer of log records in shared memory for passing
+// records from many producer processes to a single collector process.
+// The ring consists of a fixed number of slots of a fixed size and each
+// record is formatted directly into a slot, so emitting a record costs no
+// system calls or copies. A record that doesn't fit into a slot is
+// truncated. If the ring is full, records are dropped and counted rather
+// than blocking the producer. Committed records are stored in the shared
+// memory, so they are not lost if the producer crashes.
+//
+// The ring is created when it is first mapped from an empty file. All
+// processes that may create the ring should use the same parameters.
+// Otherwise the parameters are taken from the file.
+//
+// Example:
+//   // Producer:
+//   fmt::File f = fmt::File::open_shared("/myapp-log");
+//   fmt::LogRing ring(f);
+//   ring.print("request {} took {} ms", id, time);
+//
+//   // Collector:
+//   fmt::File f = fmt::File::open_shared("/myapp-log");
+//   fmt::LogRing ring(f);
+//   fmt::MemoryWriter w;
+//   while (ring.read(w))
+//     w << '\n';
+class LogRing {
+ private:
+  struct Header;
+  struct Slot;
+
+  Header *header_;
+  char *slots_;
+  std::size_t size_;  // The size of the mapping in bytes.
+  std::size_t slot_size_;
+  uint64_t mask_;
+
+  FMT_DISALLOW_COPY_AND_ASSIGN(LogRing);
+
+  Slot *slot(uint64_t pos) const;
+
+ public:
+  // Maps the ring stored in file f creating it with num_slots slots of
+  // slot_size bytes each if the file is empty. num_slots is rounded up to
+  // a power of two and slot_size is rounded up to a multiple of 8.
+  // A part of each slot is used to store the record header.
+  explicit LogRing(File &f, unsigned num_slots = 1024,
+                   std::size_t slot_size = 256);
+
+  ~LogRing() FMT_NOEXCEPT;
+
+  // Returns the maximum size of a record that is not truncated.
+  std::size_t max_record_size() const;
+
+  // Returns the number of records dropped because the ring was full or
+  // the collector skipped them.
+  ULongLong num_dropped() const;
+
+  // Formats args according to specifications in format_str and commits
+  // the result to the ring as a single record. Returns false if the record
+  // was dropped.
+  bool print(StringRef format_str, ArgList args);
+  FMT_VARIADIC(bool, print, StringRef)
+
+  // Appends the next committed record to w and removes it from the ring.
+  // Returns false if the next record has not been committed yet.
+  // If truncated is not null, it is set to whether the record was truncated.
+  // Only one process should read from the ring.
+  bool read(Writer &w, bool *truncated = 0);
+
+  // Skips the next record if a producer has started writing it but has not
+  // committed it, e.g. because the producer crashed. Returns false if there
+  // is no such record. The collector can call it when read has been
+  // returning false for longer than a record takes to write. Skipping a
+  // record of a live producer that is just slow discards the record, which
+  // is counted as dropped, and may corrupt the record that is written to
+  // the same slot next.
+  bool skip();
+};
+#endif
 }  // namespace fmt
 
 #if !FMT_USE_RVALUE_REFERENCES
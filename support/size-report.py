@@ -0,0 +1,135 @@
+#!/usr/bin/env python
+# Reports the code size of the library.
+#
+# Usage: size-report.py [--baseline REV] [cmake-option...]
+#
+# By default builds the library with and without wchar_t support and
+# reports the difference. With --baseline builds the library at the git
+# revision REV and in the working tree and compares them. In both cases
+# the sizes of the main formatting functions, whose code is executed for
+# every replacement field, are listed.
+#
+# Extra arguments are passed to cmake for all builds, for example
+# -DCMAKE_BUILD_TYPE=MinSizeRel. Requires binutils (size and nm).
+
+from __future__ import print_function
+import os, re, shutil, sys, tempfile
+from subprocess import check_call, check_output
+
+CACHE_LINE_SIZE = 64
+
+HOT_FUNCTIONS = [
+  'fmt::BasicFormatter<char>::format(char const*&, fmt::internal::Arg const&)',
+  'fmt::BasicFormatter<char>::format(fmt::BasicStringRef<char>, '
+    'fmt::ArgList const&)',
+  'fmt::BasicFormatter<char>::format(fmt::internal::FormatPart<char> const*, '
+    'unsigned long, fmt::ArgList const&)',
+  'fmt::internal::ArgVisitor<fmt::internal::ArgFormatter<char>, void>::'
+    'visit(fmt::internal::Arg const&)',
+  'fmt::internal::PrintfFormatter<char>::format(fmt::BasicWriter<char>&, '
+    'fmt::BasicStringRef<char>, fmt::ArgList const&)'
+]
+
+source_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+def build(source_dir, build_dir, options):
+  """Configures and builds the format library in build_dir."""
+  os.mkdir(build_dir)
+  with open(os.devnull, 'w') as devnull:
+    check_call(['cmake', source_dir] + options, cwd=build_dir, stdout=devnull)
+    check_call(['cmake', '--build', '.', '--target', 'format'],
+               cwd=build_dir, stdout=devnull)
+  return os.path.join(build_dir, 'libformat.a')
+
+def text_size(lib):
+  """Returns the total size of text sections in lib."""
+  output = check_output(['size', '-t', lib]).decode()
+  return int(output.splitlines()[-1].split()[0])
+
+def functions(lib):
+  """Returns a list of (size, name) of functions defined in lib."""
+  output = check_output(['nm', '-C', '-S', '-t', 'd', '--size-sort', lib])
+  result = []
+  for line in output.decode().splitlines():
+    fields = line.split(None, 3)
+    if len(fields) == 4 and fields[2] in 'tTwW':
+      result.append((int(fields[1]), fields[3]))
+  return result
+
+def cache_lines(funcs):
+  """
+  Returns the number of cache lines occupied by funcs assuming each
+  function starts at a cache line boundary.
+  """
+  return sum((size + CACHE_LINE_SIZE - 1) // CACHE_LINE_SIZE
+             for size, name in funcs)
+
+def hot_size(funcs, name):
+  """
+  Returns the size of the hot part of the function with the given name
+  excluding code that the compiler moved to a cold section.
+  """
+  clone = re.compile(re.escape(name) + r'( \[clone \.(?!cold)[^]]*\])*$')
+  return sum(size for size, n in funcs if clone.match(n))
+
+def percent(old, new):
+  return 100.0 * (new - old) / old if old else 0
+
+def compare(names, libs):
+  funcs = [functions(lib) for lib in libs]
+  print('{:<18} {:>10} {:>10} {:>8}'.format('', names[0], names[1], 'change'))
+  rows = [
+    ('text', [text_size(lib) for lib in libs]),
+    ('functions', [len(f) for f in funcs]),
+    ('function bytes', [sum(size for size, name in f) for f in funcs]),
+    ('{}B lines'.format(CACHE_LINE_SIZE), [cache_lines(f) for f in funcs])
+  ]
+  for label, (old, new) in rows:
+    print('{:<18} {:>10} {:>10} {:>+7.1f}%'.format(
+      label, old, new, percent(old, new)))
+  print('\nHot functions (bytes excluding cold sections):')
+  for name in HOT_FUNCTIONS:
+    old, new = hot_size(funcs[0], name), hot_size(funcs[1], name)
+    print('{:>8} {:>8} {:>+7.1f}%  {}'.format(
+      old, new, percent(old, new), name[:80]))
+  return funcs
+
+args = sys.argv[1:]
+baseline = None
+if args[:1] == ['--baseline']:
+  if len(args) < 2:
+    sys.exit('usage: size-report.py [--baseline REV] [cmake-option...]')
+  baseline = args[1]
+  args = args[2:]
+options = args
+if not any(opt.startswith('-DCMAKE_BUILD_TYPE') for opt in options):
+  options.append('-DCMAKE_BUILD_TYPE=Release')
+
+tmp_dir = tempfile.mkdtemp()
+try:
+  if baseline:
+    baseline_dir = os.path.join(tmp_dir, 'src')
+    check_call(['git', 'worktree', 'add', '--detach', baseline_dir, baseline],
+               cwd=source_dir)
+    try:
+      old_lib = build(baseline_dir, os.path.join(tmp_dir, 'old'), options)
+    finally:
+      shutil.rmtree(baseline_dir)
+      check_call(['git', 'worktree', 'prune'], cwd=source_dir)
+    new_lib = build(source_dir, os.path.join(tmp_dir, 'new'), options)
+    compare([baseline[:10], 'current'], [old_lib, new_lib])
+  else:
+    wide_lib = build(source_dir, os.path.join(tmp_dir, 'wide'),
+                     options + ['-DFMT_USE_WCHAR=ON'])
+    narrow_lib = build(source_dir, os.path.join(tmp_dir, 'narrow'),
+                       options + ['-DFMT_USE_WCHAR=OFF'])
+    wide_funcs, narrow_funcs = compare(['wchar_t', 'narrow'],
+                                       [wide_lib, narrow_lib])
+    narrow_names = set(name for size, name in narrow_funcs)
+    removed = sorted((f for f in wide_funcs if f[1] not in narrow_names),
+                     reverse=True)
+    print('\nLargest functions removed:')
+    for size, name in removed[:10]:
+      print('{:>8}  {}'.format(size, name[:100]))
+finally:
+  shutil.rmtree(tmp_dir)
@@ -0,0 +1,300 @@
+/*
+ Allocation budget tests.
+
+ Copyright (c) 2012-2014, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "format.h"
+#include "gtest-extra.h"
+#include "mock-allocator.h"
+
+// Counts calls to the global operator new while counting is enabled.
+// Tests are single-threaded so plain variables are sufficient.
+namespace {
+bool counting;
+std::size_t num_allocations;
+}
+
+void *operator new(std::size_t size) {
+  if (counting)
+    ++num_allocations;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *p) FMT_NOEXCEPT { std::free(p); }
+void operator delete[](void *p) FMT_NOEXCEPT { std::free(p); }
+#if __cpp_sized_deallocation
+void operator delete(void *p, std::size_t) FMT_NOEXCEPT { std::free(p); }
+void operator delete[](void *p, std::size_t) FMT_NOEXCEPT { std::free(p); }
+#endif
+
+namespace {
+
+// Counts heap allocations made during the lifetime of the object.
+class AllocationCounter {
+ private:
+  std::size_t start_;
+
+ public:
+  AllocationCounter() : start_(num_allocations) { counting = true; }
+  ~AllocationCounter() { counting = false; }
+
+  std::size_t count() const { return num_allocations - start_; }
+};
+
+// Executes statement and checks that it makes at most budget heap
+// allocations. Results of the statement are destroyed before the check.
+#define EXPECT_ALLOCATIONS(budget, statement) { \
+  std::size_t num_allocs = 0; \
+  { \
+    AllocationCounter counter; \
+    statement; \
+    num_allocs = counter.count(); \
+  } \
+  EXPECT_LE(num_allocs, static_cast<std::size_t>(budget)) << #statement; \
+}
+
+// A std::string result longer than the small string buffer is allocated
+// on the heap. Budgets for calls returning std::string include it.
+const std::size_t STRING_RESULT = 1;
+
+const std::size_t LONG_SIZE = 2 * fmt::internal::INLINE_BUFFER_SIZE;
+
+struct Point {
+  int x, y;
+};
+
+// A user-defined type formatted via the one-phase extension point.
+void format(fmt::BasicFormatter<char> &f, const char *&format_str,
+            const Point &p) {
+  f.writer().write("({}, {})", p.x, p.y);
+  if (*format_str == ':')
+    ++format_str;
+  if (*format_str == '}')
+    ++format_str;
+}
+
+// An allocator that counts allocations made by BasicMemoryWriter.
+// MockAllocator is not used because gmock's mocks of void functions such
+// as deallocate crash in optimized builds.
+struct CountingAllocator {
+  typedef char value_type;
+
+  std::size_t num_allocations;
+  std::size_t num_bytes;
+
+  CountingAllocator() : num_allocations(0), num_bytes(0) {}
+
+  char *allocate(std::size_t n) {
+    ++num_allocations;
+    num_bytes += n;
+    return static_cast<char*>(std::malloc(n));
+  }
+
+  void deallocate(char *p, std::size_t) { std::free(p); }
+};
+
+struct Date {
+  int year, month, day;
+};
+}  // namespace
+
+namespace fmt {
+// A user-defined type formatted via the two-phase extension point.
+template <>
+struct Formatter<Date> {
+  typedef char ParsedSpec;
+
+  static ParsedSpec parse(const char *&) { return 0; }
+
+  static void format(Writer &w, ParsedSpec, const Date &d) {
+    w << fmt::pad(d.year, 4, '0') << '-' << fmt::pad(d.month, 2, '0') << '-'
+      << fmt::pad(d.day, 2, '0');
+  }
+};
+}
+
+TEST(AllocationTest, CounterWorks) {
+  EXPECT_ALLOCATIONS(0, {});
+  std::size_t n = 0;
+  {
+    AllocationCounter counter;
+    delete new int(42);
+    n = counter.count();
+  }
+  EXPECT_EQ(1u, n);
+}
+
+TEST(AllocationTest, Writer) {
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w << 42);
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w << -1.5);
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w << "text" << 'c' << 42u);
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w << fmt::hex(0xcafe));
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w << fmt::pad(42, 100, '*'));
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w.write("{} {}", 42, "abc"));
+  EXPECT_ALLOCATIONS(0,
+    fmt::MemoryWriter w; w.write("{:>30.5f}|{:+#x}", 1.25, 42));
+  std::string s(LONG_SIZE, 'x');
+  EXPECT_ALLOCATIONS(1, fmt::MemoryWriter w; w << s);
+  // The buffer grows geometrically: 500 -> 750 -> 1125 -> 1687 -> 2530.
+  EXPECT_ALLOCATIONS(4, fmt::MemoryWriter w; for (int i = 0; i < 200; ++i) {
+    w << "0123456789";
+  });
+  char buffer[100];
+  EXPECT_ALLOCATIONS(0, fmt::ArrayWriter w(buffer); w.write("{}", 42));
+  // Long strings are referenced rather than copied.
+  EXPECT_ALLOCATIONS(0, fmt::GatherWriter w;
+                    w.write("{}: {}", 42, fmt::ref(s)));
+  // Messages written after a prefix reuse the storage of the previous ones.
+  fmt::PrefixedWriter pw;
+  pw << s;
+  pw.set_prefix();
+  pw.write("[{}] {:>20}", 0, "message");
+  pw.reset();
+  EXPECT_ALLOCATIONS(0, for (int i = 0; i < 100; ++i) {
+    pw.write("[{}] {:>20}", i, "message");
+    pw.reset();
+  });
+}
+
+TEST(AllocationTest, StringTable) {
+  // All strings are formatted into the reserved arena.
+  EXPECT_ALLOCATIONS(1, fmt::StringTable table; table.reserve(30000);
+    for (int i = 0; i < 1000; ++i) {
+      table.write("component.{}.requests", i);
+      table.commit();
+    });
+  // The index of unique strings is grown a logarithmic number of times.
+  EXPECT_ALLOCATIONS(1 + 2 * 7, fmt::StringTable table(true);
+    table.reserve(30000);
+    for (int i = 0; i < 1000; ++i) {
+      table.write("component.{}.requests", i % 500);
+      table.commit();
+    });
+}
+
+TEST(AllocationTest, DynamicArgList) {
+  // Up to 16 arguments and short copied strings are stored inline.
+  EXPECT_ALLOCATIONS(0, fmt::DynamicArgList args;
+    for (int i = 0; i < 15; ++i)
+      args.push_back(i);
+    args.push_back_copy("copied string");
+    fmt::MemoryWriter w;
+    w.write("{0} {1} {15}", args.args()));
+}
+
+TEST(AllocationTest, MetricsWriter) {
+  fmt::MetricsWriter w;
+  fmt::MetricsWriter::Series series[100];
+  for (int i = 0; i < 100; ++i) {
+    w.write("{}", i);
+    series[i] = w.add_series("latency_seconds", "shard",
+                             fmt::StringRef(w.data(), w.size()));
+    w.clear();
+  }
+  // After the first scrape, scrapes reuse the output buffer.
+  for (int scrape = 0; scrape < 2; ++scrape) {
+    EXPECT_ALLOCATIONS(scrape == 0 ? 10 : 0, w.clear();
+      w.write_header("latency_seconds", "gauge", "Request latency.");
+      for (int i = 0; i < 100; ++i)
+        w.sample(series[i], i * 0.125));
+  }
+}
+
+TEST(AllocationTest, Format) {
+  EXPECT_ALLOCATIONS(0, fmt::format("{}", 42));
+  EXPECT_ALLOCATIONS(0, fmt::format("{:.2f}", 3.14159));
+  EXPECT_ALLOCATIONS(STRING_RESULT,
+                     fmt::format("The answer is {:>10}.", 42));
+  std::string s(100, 'a');
+  EXPECT_ALLOCATIONS(STRING_RESULT, fmt::format("{0}{1}{0}", s, 'b'));
+  s.assign(LONG_SIZE, 'x');
+  EXPECT_ALLOCATIONS(1 + STRING_RESULT, fmt::format("{}", s));
+}
+
+TEST(AllocationTest, Sprintf) {
+  EXPECT_ALLOCATIONS(0, fmt::sprintf("%d", 42));
+  EXPECT_ALLOCATIONS(0, fmt::sprintf("%.2f", 3.14159));
+  EXPECT_ALLOCATIONS(STRING_RESULT,
+                     fmt::sprintf("The answer is %10d.", 42));
+  EXPECT_ALLOCATIONS(STRING_RESULT,
+                     fmt::sprintf("%2$s%1$c", 'b', "positional args"));
+}
+
+TEST(AllocationTest, Print) {
+  std::FILE *f = std::fopen("test-file", "w");
+  ASSERT_TRUE(f != 0);
+  // Let stdio allocate its buffer before counting.
+  std::fputc('\n', f);
+  EXPECT_ALLOCATIONS(0, fmt::print(f, "{}\n", 42));
+  EXPECT_ALLOCATIONS(0, fmt::print(f, "{:>20} {:e}\n", "right", 1e100));
+  EXPECT_ALLOCATIONS(0, fmt::fprintf(f, "%s %08x\n", "hex", 0xbeef));
+  std::string s(LONG_SIZE, 'x');
+  // The buffer is grown to fit the string exactly and then once more
+  // for the newline.
+  EXPECT_ALLOCATIONS(2, fmt::print(f, "{}\n", s));
+  std::fclose(f);
+  std::remove("test-file");
+}
+
+TEST(AllocationTest, CustomType) {
+  Point p = {1, 2};
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w.write("{}", p));
+  EXPECT_ALLOCATIONS(0, fmt::format("{}", p));
+  Date d = {2015, 3, 7};
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w.write("{}", d));
+  EXPECT_ALLOCATIONS(0, fmt::format("{}", d));
+  fmt::ParsedFormat pf("{} {}");
+  EXPECT_ALLOCATIONS(0, fmt::MemoryWriter w; w.write(pf, p, d));
+}
+
+TEST(AllocationTest, MemoryWriterAllocator) {
+  typedef AllocatorRef<CountingAllocator> TestAllocator;
+  CountingAllocator alloc;
+  {
+    fmt::BasicMemoryWriter<char, TestAllocator> w((TestAllocator(&alloc)));
+    w.write("{} {:.3f} {:>20} {:#x}", 42, 1.5, "text", 255u);
+    w << 'c' << -7 << fmt::pad(1, 50);
+  }
+  EXPECT_EQ(0u, alloc.num_allocations);
+  // A long message allocates exactly once.
+  {
+    fmt::BasicMemoryWriter<char, TestAllocator> w((TestAllocator(&alloc)));
+    w.write("{}", std::string(LONG_SIZE, 'x'));
+  }
+  EXPECT_EQ(1u, alloc.num_allocations);
+  EXPECT_EQ(LONG_SIZE, alloc.num_bytes);
+}
@@ -0,0 +1,246 @@
+/*
+ Tests of the C interface.
+
+ Copyright (c) 2012-2014, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cfloat>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <limits>
+#include <string>
+
+#include <stdint.h>
+
+#include "cformat.h"
+#include "gtest-extra.h"
+
+namespace {
+
+const int BUFFER_SIZE = 256;
+
+// Checks that fmt_snprintf and snprintf produce the same output and
+// return the same value.
+#define EXPECT_SNPRINTF(...) { \
+  char expected[BUFFER_SIZE], actual[BUFFER_SIZE]; \
+  int expected_size = std::snprintf(expected, BUFFER_SIZE, __VA_ARGS__); \
+  int actual_size = fmt_snprintf(actual, BUFFER_SIZE, __VA_ARGS__); \
+  EXPECT_EQ(expected_size, actual_size) << #__VA_ARGS__; \
+  EXPECT_EQ(std::string(expected, expected_size < BUFFER_SIZE ? \
+                        expected_size : BUFFER_SIZE - 1), \
+            std::string(actual, actual_size < BUFFER_SIZE ? \
+                        actual_size : BUFFER_SIZE - 1)) << #__VA_ARGS__; \
+}
+
+const char *const FLAGS[] = {
+  "", "-", "+", " ", "#", "0", "-+", "- ", "-#", "+0", " 0", "#0", "-+#0"
+};
+const char *const WIDTHS[] = {"", "1", "7", "25", "*"};
+const char *const PRECISIONS[] = {"", ".0", ".1", ".5", ".20", ".*"};
+
+// Checks all combinations of flags, width and precision for the given
+// length modifier, conversion and value against the C library.
+template <typename T>
+void check_specs(const char *length, char type, T value) {
+  static const int STAR_VALUES[] = {0, 3, -4, 12};
+  for (std::size_t f = 0; f < sizeof(FLAGS) / sizeof(*FLAGS); ++f) {
+    for (std::size_t w = 0; w < sizeof(WIDTHS) / sizeof(*WIDTHS); ++w) {
+      for (std::size_t p = 0; p < sizeof(PRECISIONS) / sizeof(*PRECISIONS);
+           ++p) {
+        std::string format = std::string("[%") + FLAGS[f] + WIDTHS[w] +
+            PRECISIONS[p] + length + type + "]";
+        const char *s = format.c_str();
+        bool star_width = *WIDTHS[w] == '*', star_precision = p == 5;
+        for (std::size_t i = 0;
+             i < sizeof(STAR_VALUES) / sizeof(*STAR_VALUES); ++i) {
+          int star = STAR_VALUES[i];
+          if (star_width && star_precision)
+            EXPECT_SNPRINTF(s, star, star - 1, value)
+          else if (star_width || star_precision)
+            EXPECT_SNPRINTF(s, star, value)
+          else
+            EXPECT_SNPRINTF(s, value)
+          if (!star_width && !star_precision)
+            break;
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void check_int_specs(const char *length, T value) {
+  const char *types = std::numeric_limits<T>::is_signed ? "di" : "uoxX";
+  for (const char *type = types; *type; ++type)
+    check_specs(length, *type, value);
+}
+
+template <typename T>
+void check_float_specs(const char *length, T value) {
+  for (const char *type = "eEfFgGaA"; *type; ++type)
+    check_specs(length, *type, value);
+}
+}  // namespace
+
+TEST(CFormatTest, Snprintf) {
+  char buffer[BUFFER_SIZE];
+  EXPECT_EQ(10, fmt_snprintf(buffer, sizeof(buffer), "%s, %d!", "Hello", 42));
+  EXPECT_STREQ("Hello, 42!", buffer);
+  EXPECT_EQ(4, fmt_snprintf(buffer, sizeof(buffer), "%d%%", 100));
+  EXPECT_STREQ("100%", buffer);
+}
+
+TEST(CFormatTest, Truncation) {
+  char buffer[4] = "abc";
+  EXPECT_EQ(5, fmt_snprintf(buffer, 0, "%d", 12345));
+  EXPECT_STREQ("abc", buffer);
+  EXPECT_EQ(5, fmt_snprintf(0, 0, "%d", 12345));
+  EXPECT_EQ(5, fmt_snprintf(buffer, sizeof(buffer), "%d", 12345));
+  EXPECT_STREQ("123", buffer);
+  EXPECT_EQ(3, fmt_snprintf(buffer, sizeof(buffer), "%s", "xyz"));
+  EXPECT_STREQ("xyz", buffer);
+  EXPECT_EQ(1, fmt_snprintf(buffer, 1, "%c", 'x'));
+  EXPECT_STREQ("", buffer);
+}
+
+TEST(CFormatTest, Sprintf) {
+  char buffer[BUFFER_SIZE];
+  EXPECT_EQ(11, fmt_sprintf(buffer, "%05d|%-4x|", 42, 255u));
+  EXPECT_STREQ("00042|ff  |", buffer);
+}
+
+TEST(CFormatTest, Fprintf) {
+  EXPECT_WRITE(stdout, fmt_printf("%s %d\n", "answer", 42), "answer 42\n");
+  EXPECT_WRITE(stderr, fmt_fprintf(stderr, "%.2f", 1.125), "1.12");
+}
+
+TEST(CFormatTest, Int) {
+  static const int INTS[] = {0, 1, -1, 42, -12345, INT_MIN, INT_MAX};
+  for (std::size_t i = 0; i < sizeof(INTS) / sizeof(*INTS); ++i) {
+    check_int_specs("", INTS[i]);
+    check_int_specs("", static_cast<unsigned>(INTS[i]));
+    check_int_specs("hh", INTS[i]);
+    check_int_specs("hh", static_cast<unsigned>(INTS[i]));
+    check_int_specs("h", INTS[i]);
+    check_int_specs("h", static_cast<unsigned>(INTS[i]));
+  }
+}
+
+TEST(CFormatTest, LongInt) {
+  static const long long INTS[] = {
+    0, 1, -1, 1234567890123LL, LLONG_MIN, LLONG_MAX
+  };
+  for (std::size_t i = 0; i < sizeof(INTS) / sizeof(*INTS); ++i) {
+    long long n = INTS[i];
+    check_int_specs("l", static_cast<long>(n));
+    check_int_specs("l", static_cast<unsigned long>(n));
+    check_int_specs("ll", n);
+    check_int_specs("ll", static_cast<unsigned long long>(n));
+    check_int_specs("j", static_cast<intmax_t>(n));
+    check_int_specs("j", static_cast<uintmax_t>(n));
+    check_int_specs("z", static_cast<std::size_t>(n));
+    check_int_specs("t", static_cast<std::ptrdiff_t>(n));
+  }
+}
+
+TEST(CFormatTest, Char) {
+  static const char CHARS[] = {'x', ' ', '%', '\0'};
+  for (std::size_t i = 0; i < sizeof(CHARS); ++i)
+    check_specs("", 'c', CHARS[i]);
+}
+
+TEST(CFormatTest, String) {
+  check_specs("", 's', "");
+  check_specs("", 's', "abc");
+  check_specs("", 's', "a longer string that exceeds the widths");
+  // Null strings are passed to the C library which prints "(null)". Not
+  // compared with snprintf because passing null to it is undefined.
+  const char *null_str = 0;
+  char buffer[BUFFER_SIZE];
+  EXPECT_EQ(6, fmt_snprintf(buffer, BUFFER_SIZE, "%s", null_str));
+  EXPECT_STREQ("(null)", buffer);
+  EXPECT_SNPRINTF("%10s|%-3s|%.2s", "right", "left", "truncated");
+}
+
+TEST(CFormatTest, Pointer) {
+  int n = 0;
+  check_specs("", 'p', static_cast<void*>(&n));
+  void *null_ptr = 0;
+  EXPECT_SNPRINTF("%p", null_ptr);
+  EXPECT_SNPRINTF("%20p", null_ptr);
+}
+
+TEST(CFormatTest, Double) {
+  static const double DOUBLES[] = {
+    0.0, -0.0, 1.0, -1.5, 0.1, 3.14159265358979, 1e-10, 123456789.125,
+    1e100, DBL_MIN, DBL_MAX
+  };
+  for (std::size_t i = 0; i < sizeof(DOUBLES) / sizeof(*DOUBLES); ++i)
+    check_float_specs("", DOUBLES[i]);
+  check_float_specs("l", 2.5);
+  check_float_specs("", std::numeric_limits<double>::infinity());
+  check_float_specs("", -std::numeric_limits<double>::infinity());
+  check_float_specs("", std::numeric_limits<double>::quiet_NaN());
+}
+
+TEST(CFormatTest, LongDouble) {
+  static const long double DOUBLES[] = {0.0L, -1.5L, 3.14159265358979323846L};
+  for (std::size_t i = 0; i < sizeof(DOUBLES) / sizeof(*DOUBLES); ++i)
+    check_float_specs("L", DOUBLES[i]);
+}
+
+TEST(CFormatTest, MultipleArgs) {
+  EXPECT_SNPRINTF("%d %s %c %.3f %x %p|", -7, "str", 'c', 2.5, 0xcafeu,
+                  static_cast<void*>(0));
+  EXPECT_SNPRINTF("%s=%08.3f (%+d%%) [%-*s] %lu %lld %hhd", "value", -3.25,
+                  12, 6, "ab", 123456789ul, -1LL, 300);
+  EXPECT_SNPRINTF("%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d",
+                  1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+                  18, 19, 20);
+}
+
+// Features not supported by the formatting library are passed to the
+// C library.
+TEST(CFormatTest, Fallback) {
+  EXPECT_SNPRINTF("%2$s %1$s", "world", "hello");
+  // This format string is invalid. It is built at runtime to avoid the
+  // compile-time format check.
+  std::string invalid_format = std::string("%*1$") + "d|";
+  EXPECT_SNPRINTF(invalid_format.c_str(), 5);
+  EXPECT_SNPRINTF("%.d|%.f", 0, 1.5);
+  EXPECT_SNPRINTF("%ls", L"wide");
+  EXPECT_SNPRINTF("%lc", static_cast<wint_t>(L'w'));
+  EXPECT_SNPRINTF("%'d", 1234567);
+  EXPECT_SNPRINTF(
+      "%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d",
+      1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
+      21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34);
+  int n = 0;
+  char buffer[BUFFER_SIZE];
+  EXPECT_EQ(6, fmt_snprintf(buffer, sizeof(buffer), "abc%ndef", &n));
+  EXPECT_EQ(3, n);
+  EXPECT_STREQ("abcdef", buffer);
+}
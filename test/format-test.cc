@@ -29,11 +29,13 @@
 #include <cfloat>
 #include <climits>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <memory>
 #include <sstream>
+#include <vector>
 #include <stdint.h>
 
 #if FMT_USE_TYPE_TRAITS
@@ -67,7 +69,9 @@ using fmt::format;
 using fmt::FormatError;
 using fmt::StringRef;
 using fmt::MemoryWriter;
+#if FMT_USE_WCHAR
 using fmt::WMemoryWriter;
+#endif
 using fmt::pad;
 
 namespace {
@@ -93,7 +97,11 @@ struct AnyWriteChecker {
   template <typename T>
   ::testing::AssertionResult operator()(const char *, const T &value) const {
     ::testing::AssertionResult result = check_write<char>(value, "char");
+#if FMT_USE_WCHAR
     return result ? check_write<wchar_t>(value, "wchar_t") : result;
+#else
+    return result;
+#endif
   }
 };
 
@@ -292,9 +300,11 @@ TEST(WriterTest, WriteChar) {
   CHECK_WRITE('a');
 }
 
+#if FMT_USE_WCHAR
 TEST(WriterTest, WriteWideChar) {
   CHECK_WRITE_WCHAR(L'a');
 }
+#endif
 
 TEST(WriterTest, WriteString) {
   CHECK_WRITE_CHAR("abc");
@@ -302,11 +312,13 @@ TEST(WriterTest, WriteString) {
   //MemoryWriter() << L"abc";
 }
 
+#if FMT_USE_WCHAR
 TEST(WriterTest, WriteWideString) {
   CHECK_WRITE_WCHAR(L"abc");
   // The following line shouldn't compile:
   //fmt::WMemoryWriter() << "abc";
 }
+#endif
 
 TEST(WriterTest, bin) {
   using fmt::bin;
@@ -430,11 +442,13 @@ TEST(WriterTest, PadString) {
   EXPECT_EQ("test******", (MemoryWriter() << pad("test", 10, '*')).str());
 }
 
+#if FMT_USE_WCHAR
 TEST(WriterTest, PadWString) {
   EXPECT_EQ(L"test    ", (WMemoryWriter() << pad(L"test", 8)).str());
   EXPECT_EQ(L"test******", (WMemoryWriter() << pad(L"test", 10, '*')).str());
   EXPECT_EQ(L"test******", (WMemoryWriter() << pad(L"test", 10, L'*')).str());
 }
+#endif
 
 TEST(WriterTest, NoConflictWithIOManip) {
   using namespace std;
@@ -457,9 +471,462 @@ TEST(WriterTest, Format) {
   EXPECT_EQ("part1part2", w.str());
 }
 
+#if FMT_USE_WCHAR
 TEST(WriterTest, WWriter) {
   EXPECT_EQ(L"cafe", (fmt::WMemoryWriter() << fmt::hex(0xcafe)).str());
 }
+#endif
+
+TEST(WriterTest, MarkRollback) {
+  MemoryWriter w;
+  w << "abc";
+  std::size_t mark = w.mark();
+  EXPECT_EQ(3u, mark);
+  w.write("{:>10}", 42);
+  EXPECT_EQ(13u, w.size());
+  w.rollback(mark);
+  EXPECT_EQ("abc", w.str());
+  w << 'd';
+  EXPECT_EQ("abcd", w.str());
+  // A mark past the end of the output is ignored.
+  w.rollback(100);
+  EXPECT_EQ("abcd", w.str());
+  w.rollback(0);
+  EXPECT_EQ("", w.str());
+}
+
+TEST(WriterTest, RollbackKeepsCapacity) {
+  char array[10];
+  fmt::ArrayWriter w(array);
+  w << "0123456789";
+  w.rollback(2);
+  w << "abcdefgh";
+  EXPECT_EQ("01abcdefgh", w.str());
+}
+
+TEST(PrefixedWriterTest, Reset) {
+  fmt::PrefixedWriter w;
+  EXPECT_EQ(0u, w.prefix_size());
+  w.write("[{}:{}] ", 42, "main");
+  w.set_prefix();
+  EXPECT_EQ(10u, w.prefix_size());
+  EXPECT_EQ("", std::string(w.message()));
+  w.write("message {}", 1);
+  EXPECT_EQ("[42:main] message 1", w.str());
+  EXPECT_EQ("message 1", std::string(w.message()));
+  w.reset();
+  EXPECT_EQ("[42:main] ", w.str());
+  w << "message " << 2;
+  EXPECT_EQ("[42:main] message 2", w.str());
+}
+
+TEST(PrefixedWriterTest, LongMessage) {
+  fmt::PrefixedWriter w;
+  w << "prefix: ";
+  w.set_prefix();
+  std::string s(2000, 'x');
+  w << s;
+  EXPECT_EQ("prefix: " + s, w.str());
+  w.reset();
+  w << 42;
+  EXPECT_EQ("prefix: 42", w.str());
+}
+
+TEST(PrefixedWriterTest, RollbackIntoPrefix) {
+  fmt::PrefixedWriter w;
+  w << "prefix";
+  w.set_prefix();
+  w << "message";
+  w.rollback(3);
+  EXPECT_EQ(3u, w.prefix_size());
+  EXPECT_EQ("pre", w.str());
+  w << "!";
+  w.reset();
+  EXPECT_EQ("pre", w.str());
+}
+
+TEST(PrefixedWriterTest, Clear) {
+  fmt::PrefixedWriter w;
+  w << "prefix";
+  w.set_prefix();
+  w << "message";
+  w.clear();
+  EXPECT_EQ(0u, w.prefix_size());
+  EXPECT_EQ("", w.str());
+}
+
+TEST(PrefixedWriterTest, ShortenThroughBase) {
+  fmt::PrefixedWriter w;
+  w << "prefix";
+  w.set_prefix();
+  w << "message";
+  fmt::Writer &base = w;
+  base.rollback(3);
+  EXPECT_EQ(3u, w.prefix_size());
+  EXPECT_EQ("", std::string(w.message()));
+  base.clear();
+  EXPECT_EQ(0u, w.prefix_size());
+  EXPECT_EQ("", std::string(w.message()));
+  w << "abc";
+  EXPECT_EQ("abc", std::string(w.message()));
+  w.reset();
+  EXPECT_EQ("", w.str());
+}
+
+#if FMT_USE_WCHAR
+TEST(PrefixedWriterTest, WChar) {
+  fmt::WPrefixedWriter w;
+  w << L"id=" << 7 << L": ";
+  w.set_prefix();
+  w.write(L"{}", 42);
+  EXPECT_EQ(L"id=7: 42", w.str());
+  w.reset();
+  EXPECT_EQ(L"id=7: ", w.str());
+}
+#endif
+
+TEST(StringTableTest, Commit) {
+  fmt::StringTable table;
+  table.write("{}.{}", "http", "requests");
+  fmt::StringTable::Entry a = table.commit();
+  EXPECT_EQ(0u, a.offset);
+  EXPECT_EQ(13u, a.size);
+  table << "errors" << '_' << 42;
+  fmt::StringTable::Entry b = table.commit();
+  EXPECT_EQ(13u, b.offset);
+  EXPECT_EQ(9u, b.size);
+  fmt::StringTable::Entry c = table.commit();
+  EXPECT_EQ(0u, c.size);
+  EXPECT_EQ("http.requests", std::string(table[a]));
+  EXPECT_EQ("errors_42", std::string(table[b]));
+  EXPECT_EQ("", std::string(table[c]));
+  EXPECT_EQ("http.requestserrors_42", table.str());
+}
+
+TEST(StringTableTest, Add) {
+  fmt::StringTable table;
+  fmt::StringTable::Entry a = table.add("abc");
+  fmt::StringTable::Entry b = table.add("abc");
+  EXPECT_EQ(0u, a.offset);
+  EXPECT_EQ(3u, b.offset);
+  table << "x";
+  fmt::StringTable::Entry c = table.add("yz");
+  EXPECT_EQ("xyz", std::string(table[c]));
+}
+
+TEST(StringTableTest, EntriesSurviveGrowth) {
+  fmt::StringTable table;
+  fmt::StringTable::Entry first = table.add("first");
+  std::vector<fmt::StringTable::Entry> entries;
+  for (int i = 0; i < 1000; ++i) {
+    table.write("name{}", i);
+    entries.push_back(table.commit());
+  }
+  EXPECT_EQ("first", std::string(table[first]));
+  for (int i = 0; i < 1000; ++i)
+    EXPECT_EQ(format("name{}", i), std::string(table[entries[i]]));
+}
+
+TEST(StringTableTest, Deduplicate) {
+  fmt::StringTable table(true);
+  std::vector<fmt::StringTable::Entry> entries;
+  for (int i = 0; i < 3000; ++i) {
+    table.write("metric_{}", i % 1000);
+    entries.push_back(table.commit());
+  }
+  // Only the first 1000 strings are stored: 7 * 1000 characters of
+  // "metric_" and 10 * 1 + 90 * 2 + 900 * 3 digits.
+  EXPECT_EQ(9890u, table.size());
+  for (int i = 0; i < 3000; ++i) {
+    fmt::StringTable::Entry e = entries[i], unique = entries[i % 1000];
+    EXPECT_EQ(unique.offset, e.offset);
+    EXPECT_EQ(unique.size, e.size);
+    EXPECT_EQ(format("metric_{}", i % 1000), std::string(table[e]));
+  }
+  fmt::StringTable::Entry a = table.add("");
+  fmt::StringTable::Entry b = table.add("");
+  EXPECT_EQ(a.offset, b.offset);
+  // A string that has a prefix equal to another one is not a duplicate.
+  fmt::StringTable::Entry c = table.add("metric_1");
+  fmt::StringTable::Entry d = table.add("metric_10");
+  EXPECT_EQ(entries[1].offset, c.offset);
+  EXPECT_EQ(entries[10].offset, d.offset);
+  EXPECT_EQ("metric_10", std::string(table[d]));
+}
+
+TEST(StringTableTest, Rollback) {
+  fmt::StringTable table;
+  fmt::StringTable::Entry a = table.add("abc");
+  table << "def";
+  table.rollback(0);
+  EXPECT_EQ("abc", table.str());
+  table << "gh";
+  fmt::StringTable::Entry b = table.commit();
+  EXPECT_EQ("abc", std::string(table[a]));
+  EXPECT_EQ("gh", std::string(table[b]));
+}
+
+TEST(StringTableTest, Clear) {
+  fmt::StringTable table(true);
+  table.add("abc");
+  table.clear();
+  EXPECT_EQ(0u, table.size());
+  fmt::StringTable::Entry e = table.add("def");
+  EXPECT_EQ(0u, e.offset);
+  EXPECT_EQ(0u, table.add("def").offset);
+}
+
+TEST(StringTableTest, ShortenThroughBase) {
+  fmt::StringTable table(true);
+  fmt::StringTable::Entry a = table.add("abc");
+  table << "def";
+  fmt::Writer &base = table;
+  base.rollback(0);
+  EXPECT_EQ("abc", table.str());
+  base.clear();
+  EXPECT_EQ(0u, table.size());
+  table << "x";
+  fmt::StringTable::Entry b = table.commit();
+  EXPECT_EQ(0u, b.offset);
+  EXPECT_EQ("x", std::string(table[b]));
+  a = table.add("abc");
+  EXPECT_EQ(1u, a.offset);
+  EXPECT_EQ("abc", std::string(table[a]));
+}
+
+#if FMT_USE_WCHAR
+TEST(StringTableTest, WChar) {
+  fmt::WStringTable table(true);
+  table.write(L"{}", 42);
+  fmt::WStringTable::Entry a = table.commit();
+  fmt::WStringTable::Entry b = table.add(L"42");
+  EXPECT_EQ(a.offset, b.offset);
+  EXPECT_EQ(L"42", std::wstring(table[b]));
+}
+#endif
+
+TEST(GatherWriterTest, Segments) {
+  std::string payload(20, 'x');
+  fmt::GatherWriter w(10);
+  w.write("[{}] {} {}", 42, fmt::ref(payload), fmt::ref("short"));
+  ASSERT_EQ(3u, w.num_segments());
+  EXPECT_EQ("[42] ", std::string(w.segment(0)));
+  EXPECT_EQ(payload.data(), w.segment(1).c_str());
+  EXPECT_EQ(20u, w.segment(1).size());
+  EXPECT_EQ(" short", std::string(w.segment(2)));
+  EXPECT_EQ(31u, w.size());
+  EXPECT_EQ("[42] " + payload + " short", w.str());
+}
+
+TEST(GatherWriterTest, Threshold) {
+  fmt::GatherWriter w(4);
+  w.write("{}{}", fmt::ref("abc"), fmt::ref("abcd"));
+  ASSERT_EQ(3u, w.num_segments());
+  EXPECT_EQ("abc", std::string(w.segment(0)));
+  EXPECT_EQ("abcd", std::string(w.segment(1)));
+  EXPECT_EQ("", std::string(w.segment(2)));
+}
+
+TEST(GatherWriterTest, PaddingAndPrecision) {
+  std::string payload(20, 'x');
+  fmt::GatherWriter w(10);
+  // Padded strings are copied.
+  w.write("{:>25}|{:<25}|{:^25}",
+          fmt::ref(payload), fmt::ref(payload), fmt::ref(payload));
+  EXPECT_EQ(1u, w.num_segments());
+  // A width not exceeding the size of the string doesn't add padding.
+  w.write("{:20}", fmt::ref(payload));
+  EXPECT_EQ(3u, w.num_segments());
+  // Precision limits the size of the referenced string.
+  w.write("{:.15s}", fmt::ref(payload));
+  ASSERT_EQ(5u, w.num_segments());
+  EXPECT_EQ(15u, w.segment(3).size());
+  w.write("{:.5}", fmt::ref(payload));
+  EXPECT_EQ(5u, w.num_segments());
+  EXPECT_EQ(format("{:>25}|{:<25}|{:^25}", payload, payload, payload) +
+            payload + std::string(20, 'x'), w.str());
+}
+
+TEST(GatherWriterTest, InvalidSpec) {
+  fmt::GatherWriter w;
+  EXPECT_THROW_MSG(w.write("{:+}", fmt::ref("abc")), FormatError,
+      "format specifier '+' requires numeric argument");
+  EXPECT_THROW_MSG(w.write("{:d}", fmt::ref("abc")), FormatError,
+      "unknown format code 'd' for string");
+  EXPECT_THROW_MSG(w.write("{:.{}}", fmt::ref("abc"), 1), FormatError,
+      "nested precision is not supported for this type");
+}
+
+TEST(GatherWriterTest, OtherArgsAreCopied) {
+  std::string payload(1000, 'y');
+  fmt::GatherWriter w(10);
+  w << payload;
+  w.write("{}", 1.5);
+  w.write("{}", payload);
+  w.write("{}", fmt::StringRef(payload));
+  w.write("{}", payload.c_str());
+  EXPECT_EQ(1u, w.num_segments());
+  EXPECT_EQ(payload + "1.5" + payload + payload + payload, w.str());
+}
+
+// A type whose operator<< produces a long string.
+struct LongOutput {};
+
+std::ostream &operator<<(std::ostream &os, LongOutput) {
+  return os << std::string(600, 'o');
+}
+
+// A type formatted via a local string.
+struct LocalString {};
+
+void format(fmt::BasicFormatter<char> &f, const char *&format_str,
+            LocalString) {
+  std::string s(600, 'l');
+  f.writer().write("{}", s);
+  if (*format_str == ':')
+    ++format_str;
+  if (*format_str == '}')
+    ++format_str;
+}
+
+TEST(GatherWriterTest, TemporariesAreCopied) {
+  // The strings formatted by operator<< and by the format function of
+  // LocalString are destroyed before the output is used, so they must be
+  // copied.
+  fmt::GatherWriter w(10);
+  w.write("{}", LongOutput());
+  EXPECT_EQ(1u, w.num_segments());
+  EXPECT_EQ(std::string(600, 'o'), w.str());
+  w.clear();
+  w.write("{}", LocalString());
+  EXPECT_EQ(1u, w.num_segments());
+  EXPECT_EQ(std::string(600, 'l'), w.str());
+}
+
+TEST(GatherWriterTest, RefWithOtherWriters) {
+  std::string payload(600, 'r');
+  EXPECT_EQ("<" + payload + ">", format("<{}>", fmt::ref(payload)));
+  EXPECT_EQ("  abc", format("{:>5}", fmt::ref("abc")));
+}
+
+TEST(GatherWriterTest, Rollback) {
+  std::string payload(100, 'z');
+  fmt::GatherWriter w(10);
+  w << "a";
+  std::size_t mark = w.mark();
+  EXPECT_EQ(1u, mark);
+  w.write("{}b{}c", fmt::ref(payload), fmt::ref(payload));
+  EXPECT_EQ(203u, w.size());
+  w.rollback(150);
+  EXPECT_EQ(150u, w.size());
+  EXPECT_EQ("a" + payload + "b" + std::string(48, 'z'), w.str());
+  w.rollback(101);
+  EXPECT_EQ("a" + payload, w.str());
+  w << "d";
+  w.rollback(mark);
+  EXPECT_EQ(1u, w.num_segments());
+  EXPECT_EQ("a", w.str());
+  w.write("{}", fmt::ref(payload));
+  EXPECT_EQ("a" + payload, w.str());
+  w.clear();
+  EXPECT_EQ(0u, w.size());
+  EXPECT_EQ(1u, w.num_segments());
+  EXPECT_EQ("", w.str());
+}
+
+#if FMT_USE_WCHAR
+TEST(GatherWriterTest, WChar) {
+  std::wstring payload(20, L'x');
+  fmt::WGatherWriter w(10);
+  w.write(L"{}{}{}", L"<", fmt::ref(payload), std::string(20, 'n'));
+  // Narrow strings are converted and copied.
+  EXPECT_EQ(3u, w.num_segments());
+  EXPECT_EQ(L"<" + payload + std::wstring(20, L'n'), w.str());
+}
+#endif
+
+TEST(MetricsWriterTest, Series) {
+  fmt::MetricsWriter w;
+  fmt::MetricsWriter::Series a = w.add_series("up");
+  fmt::MetricsWriter::Series b = w.add_series("requests", "code", "200");
+  fmt::MetricsWriter::Series c =
+      w.add_series("requests", "code", "500", "path", "/a\"b\\c\nd");
+  EXPECT_EQ("up ", std::string(w.prefix(a)));
+  EXPECT_EQ("requests{code=\"200\"} ", std::string(w.prefix(b)));
+  EXPECT_EQ("requests{code=\"500\",path=\"/a\\\"b\\\\c\\nd\"} ",
+            std::string(w.prefix(c)));
+  EXPECT_EQ(0u, w.size());
+  w.sample(a, 1);
+  w.sample(b, 42u);
+  w.sample(c, -7LL, 1433000000000LL);
+  EXPECT_EQ("up 1\nrequests{code=\"200\"} 42\n"
+            "requests{code=\"500\",path=\"/a\\\"b\\\\c\\nd\"} "
+            "-7 1433000000000\n",
+            w.str());
+  w.clear();
+  w.sample(a, 0);
+  EXPECT_EQ("up 0\n", w.str());
+  w.clear_series();
+  fmt::MetricsWriter::Series d = w.add_series("down");
+  EXPECT_EQ("down ", std::string(w.prefix(d)));
+}
+
+TEST(MetricsWriterTest, Header) {
+  fmt::MetricsWriter w;
+  w.write_header("up", "gauge");
+  w.write_header("requests", "counter", "Total\\requests\n\"handled\".");
+  EXPECT_EQ("# TYPE up gauge\n"
+            "# HELP requests Total\\\\requests\\n\"handled\".\n"
+            "# TYPE requests counter\n", w.str());
+}
+
+std::string format_sample(double value) {
+  fmt::MetricsWriter w;
+  w.sample(w.add_series("x"), value);
+  std::string s = w.str();
+  return s.substr(2, s.size() - 3);
+}
+
+TEST(MetricsWriterTest, Double) {
+  EXPECT_EQ("0", format_sample(0.0));
+  EXPECT_EQ("0", format_sample(-0.0));
+  EXPECT_EQ("3", format_sample(3.0));
+  EXPECT_EQ("0.25", format_sample(0.25));
+  EXPECT_EQ("-1.5", format_sample(-1.5));
+  EXPECT_EQ("0.1", format_sample(0.1));
+  EXPECT_EQ("0.001", format_sample(1e-3));
+  EXPECT_EQ("123456.789", format_sample(123456.789));
+  EXPECT_EQ("4503599627370496", format_sample(4503599627370496.0));
+  EXPECT_EQ("1e+20", format_sample(1e20));
+  EXPECT_EQ("0.3333333333333333", format_sample(1.0 / 3));
+  EXPECT_EQ("1e-20", format_sample(1e-20));
+  EXPECT_EQ("NaN", format_sample(std::numeric_limits<double>::quiet_NaN()));
+  EXPECT_EQ("+Inf", format_sample(std::numeric_limits<double>::infinity()));
+  EXPECT_EQ("-Inf", format_sample(-std::numeric_limits<double>::infinity()));
+  EXPECT_EQ("2.5", format_sample(2.5f));
+}
+
+TEST(MetricsWriterTest, DoubleRoundTrip) {
+  double values[] = {0.1, 0.7, 1.05, 99.99, 1e-10, 12345.6789e-5, 1e15};
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(*values); ++i) {
+    for (int j = -1000; j <= 1000; ++j) {
+      double value = values[i] * j;
+      std::string s = format_sample(value);
+      EXPECT_EQ(value, std::strtod(s.c_str(), 0)) << s;
+    }
+  }
+}
+
+#if FMT_USE_WCHAR
+TEST(MetricsWriterTest, WChar) {
+  fmt::WMetricsWriter w;
+  fmt::WMetricsWriter::Series s = w.add_series(L"up", L"job", L"a\"b");
+  w.write_header(L"up", L"gauge", L"Help.");
+  w.sample(s, 0.5);
+  EXPECT_EQ(L"# HELP up Help.\n# TYPE up gauge\nup{job=\"a\\\"b\"} 0.5\n",
+            w.str());
+}
+#endif
 
 TEST(ArrayWriterTest, Ctor) {
   char array[10] = "garbage";
@@ -490,12 +957,14 @@ TEST(ArrayWriterTest, BufferOverflow) {
   EXPECT_THROW_MSG(w.write("{}", 1), std::runtime_error, "buffer overflow");
 }
 
+#if FMT_USE_WCHAR
 TEST(ArrayWriterTest, WChar) {
   wchar_t array[10];
   fmt::WArrayWriter w(array);
   w.write(L"{}", 42);
   EXPECT_EQ(L"42", w.str());
 }
+#endif
 
 TEST(FormatterTest, Escape) {
   EXPECT_EQ("{", format("{{"));
@@ -843,6 +1312,38 @@ TEST(FormatterTest, ZeroFlag) {
       FormatError, "format specifier '0' requires numeric argument");
 }
 
+TEST(FormatterTest, ZeroPaddedInt) {
+  const int values[] = {0, 7, 42, -42, 1234, 98765432, -98765432, INT_MAX};
+  char format_str[BUFFER_SIZE], expected[BUFFER_SIZE];
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(*values); ++i) {
+    for (unsigned width = 1; width <= 12; ++width) {
+      safe_sprintf(format_str, "{:0%u}", width);
+      safe_sprintf(expected, "%0*d", width, values[i]);
+      EXPECT_EQ(expected, format(format_str, values[i]));
+      safe_sprintf(format_str, "{:+0%u}", width);
+      safe_sprintf(expected, "%+0*d", width, values[i]);
+      EXPECT_EQ(expected, format(format_str, values[i]));
+      safe_sprintf(format_str, "{:0%ux}", width);
+      safe_sprintf(expected, "%0*x", width, values[i] < 0 ? 0 : values[i]);
+      EXPECT_EQ(expected, format(format_str, values[i] < 0 ? 0 : values[i]));
+    }
+  }
+  EXPECT_EQ("00000000000000000042", format("{:020}", 42ull));
+  EXPECT_EQ("18446744073709551615", format("{:020}", ULLONG_MAX));
+  EXPECT_EQ("0x00cafe", format("{:#08x}", 0xcafe));
+  EXPECT_EQ("0X00CAFE", format("{:#08X}", 0xcafe));
+  EXPECT_EQ("000-42", format("{:0>6}", -42));
+  EXPECT_EQ("-42000", format("{:0<6}", -42));
+  EXPECT_EQ("000042", format("{:0>6}", 42));
+  EXPECT_EQ("0000000012", (MemoryWriter() << pad(12, 10, '0')).str());
+  EXPECT_EQ("0000cafe",
+            (MemoryWriter() << pad(fmt::hex(0xcafe), 8, '0')).str());
+  EXPECT_EQ("00-42", (MemoryWriter() << pad(-42, 5, '0')).str());
+#if FMT_USE_WCHAR
+  EXPECT_EQ(L"0042", (fmt::WMemoryWriter() << pad(42, 4, L'0')).str());
+#endif
+}
+
 TEST(FormatterTest, Width) {
   char format_str[BUFFER_SIZE];
   safe_sprintf(format_str, "{0:%u", UINT_MAX);
@@ -871,6 +1372,51 @@ TEST(FormatterTest, Width) {
   EXPECT_EQ("test         ", format("{0:13}", TestString("test")));
 }
 
+TEST(FormatterTest, RuntimeWidth) {
+  char format_str[BUFFER_SIZE];
+  safe_sprintf(format_str, "{0:{%u", UINT_MAX);
+  increment(format_str + 4);
+  EXPECT_THROW_MSG(format(format_str, 0), FormatError, "number is too big");
+  std::size_t size = std::strlen(format_str);
+  format_str[size] = '}';
+  format_str[size + 1] = 0;
+  EXPECT_THROW_MSG(format(format_str, 0), FormatError, "number is too big");
+
+  EXPECT_THROW_MSG(format("{0:{", 0),
+      FormatError, "invalid format string");
+  EXPECT_THROW_MSG(format("{0:{}", 0),
+      FormatError, "cannot switch from manual to automatic argument indexing");
+  EXPECT_THROW_MSG(format("{0:{x}}", 0),
+      FormatError, "invalid format string");
+  EXPECT_THROW_MSG(format("{0:{1}}", 0),
+      FormatError, "argument index out of range");
+  EXPECT_THROW_MSG(format("{0:{1}", 0, 0),
+      FormatError, "missing '}' in format string");
+
+  EXPECT_THROW_MSG(format("{0:{1}}", 0, -1),
+      FormatError, "negative width");
+  EXPECT_THROW_MSG(format("{0:{1}}", 0, (INT_MAX + 1u)),
+      FormatError, "number is too big");
+  EXPECT_THROW_MSG(format("{0:{1}}", 0, -1ll),
+      FormatError, "negative width");
+  EXPECT_THROW_MSG(format("{0:{1}}", 0, (INT_MAX + 1ull)),
+      FormatError, "number is too big");
+  EXPECT_THROW_MSG(format("{0:{1}}", 0, '0'),
+      FormatError, "width is not integer");
+  EXPECT_THROW_MSG(format("{0:{1}}", 0, 0.0),
+      FormatError, "width is not integer");
+
+  EXPECT_EQ(" -42", format("{0:{1}}", -42, 4));
+  EXPECT_EQ("   42", format("{0:{1}}", 42u, 5u));
+  EXPECT_EQ("   -1.23", format("{0:{1}}", -1.23, 8ll));
+  EXPECT_EQ("str         ", format("{0:{1}}", "str", 12ull));
+  EXPECT_EQ("x  ", format("{:{}}", 'x', 3));
+  EXPECT_EQ("**42", format("{:*>{}}", 42, 4));
+  EXPECT_EQ("-0042", format("{:0{}}", -42, 5));
+  EXPECT_EQ("  1.23", format("{:{}.{}}", 1.2345, 6, 3));
+  EXPECT_EQ("  1.23", format("{2:{1}.{0}}", 3, 6, 1.2345));
+}
+
 TEST(FormatterTest, Precision) {
   char format_str[BUFFER_SIZE];
   safe_sprintf(format_str, "{0:.%u", UINT_MAX);
@@ -1031,9 +1577,11 @@ void check_unknown_types(
   }
 }
 
+#if FMT_USE_WCHAR
 TEST(FormatterTest, FormatBool) {
   EXPECT_EQ(L"1", format(L"{}", true));
 }
+#endif
 
 TEST(FormatterTest, FormatShort) {
   short s = 42;
@@ -1197,7 +1745,9 @@ TEST(FormatterTest, FormatChar) {
   check_unknown_types('a', types, "char");
   EXPECT_EQ("a", format("{0}", 'a'));
   EXPECT_EQ("z", format("{0:c}", 'z'));
+#if FMT_USE_WCHAR
   EXPECT_EQ(L"a", format(L"{0}", 'a'));
+#endif
   int n = 'x';
   for (const char *type = types + 1; *type; ++type) {
     std::string format_str = fmt::format("{{:{}}}", *type);
@@ -1206,11 +1756,13 @@ TEST(FormatterTest, FormatChar) {
   EXPECT_EQ(fmt::format("{:02X}", n), fmt::format("{:02X}", 'x'));
 }
 
+#if FMT_USE_WCHAR
 TEST(FormatterTest, FormatWChar) {
   EXPECT_EQ(L"a", format(L"{0}", L'a'));
   // This shouldn't compile:
   //format("{}", L'a');
 }
+#endif
 
 TEST(FormatterTest, FormatCString) {
   check_unknown_types("test", "s", "string");
@@ -1259,7 +1811,9 @@ TEST(FormatterTest, FormatUsingIOStreams) {
   EXPECT_EQ("The date is 2012-12-9", s);
   Date date(2012, 12, 9);
   check_unknown_types(date, "s", "string");
+#if FMT_USE_WCHAR
   EXPECT_EQ(L"The date is 2012-12-9", format(L"The date is {0}", Date(2012, 12, 9)));
+#endif
 }
 
 class Answer {};
@@ -1273,12 +1827,14 @@ TEST(FormatterTest, CustomFormat) {
   EXPECT_EQ("42", format("{0}", Answer()));
 }
 
+#if FMT_USE_WCHAR
 TEST(FormatterTest, WideFormatString) {
   EXPECT_EQ(L"42", format(L"{}", 42));
   EXPECT_EQ(L"4.2", format(L"{}", 4.2));
   EXPECT_EQ(L"abc", format(L"{}", L"abc"));
   EXPECT_EQ(L"z", format(L"{}", L'z'));
 }
+#endif
 
 TEST(FormatterTest, FormatStringFromSpeedTest) {
   EXPECT_EQ("1.2340000000:0042:+3.13:str:0x3e8:X:%",
@@ -1375,8 +1931,10 @@ TEST(FormatterTest, Examples) {
     format("The answer is {:d}", "forty-two"), FormatError,
     "unknown format code 'd' for string");
 
+#if FMT_USE_WCHAR
   EXPECT_EQ(L"Cyrillic letter \x42e",
     format(L"Cyrillic letter {}", L'\x42e'));
+#endif
 
   EXPECT_WRITE(stdout,
       fmt::print("{}", std::numeric_limits<double>::infinity()), "inf");
@@ -1426,6 +1984,190 @@ TEST(FormatIntTest, FormatDec) {
   EXPECT_EQ("42", format_decimal(42ull));
 }
 
+TEST(FormatIntTest, Base) {
+  EXPECT_EQ("deadbeef", fmt::FormatHex(0xdeadbeefu).str());
+  EXPECT_EQ("0", fmt::FormatHex(0).str());
+  EXPECT_EQ("f", fmt::FormatHex(15).str());
+  EXPECT_EQ("10", fmt::FormatHex(16).str());
+  EXPECT_EQ("100", fmt::FormatHex(256).str());
+  EXPECT_EQ("-2a", fmt::FormatHex(-42).str());
+  EXPECT_EQ("755", fmt::BasicFormatInt<8>(0755).str());
+  EXPECT_EQ("101010", fmt::BasicFormatInt<2>(42).str());
+  fmt::ULongLong max = std::numeric_limits<fmt::ULongLong>::max();
+  EXPECT_EQ(format("{:b}", max), fmt::BasicFormatInt<2>(max).str());
+  EXPECT_EQ(format("{:o}", max), fmt::BasicFormatInt<8>(max).str());
+  EXPECT_EQ(format("{:x}", max), fmt::FormatHex(max).str());
+  fmt::LongLong min = std::numeric_limits<fmt::LongLong>::min();
+  EXPECT_EQ(format("{:b}", min), fmt::BasicFormatInt<2>(min).str());
+  EXPECT_EQ(format("{:x}", min), fmt::FormatHex(min).str());
+  for (unsigned i = 0; i < 4096; ++i)
+    EXPECT_EQ(format("{:x}", i), fmt::FormatHex(i).str());
+}
+
+TEST(FormatIntTest, Width) {
+  EXPECT_EQ("0007", (fmt::BasicFormatInt<10, 4>(7).str()));
+  EXPECT_EQ("-007", (fmt::BasicFormatInt<10, 4>(-7).str()));
+  EXPECT_EQ("12345", (fmt::BasicFormatInt<10, 4>(12345).str()));
+  EXPECT_EQ("000000ff", (fmt::BasicFormatInt<16, 8>(255).str()));
+  EXPECT_EQ("0644", (fmt::BasicFormatInt<8, 4>(0644).str()));
+  EXPECT_EQ(format("{:0100}", 42), (fmt::BasicFormatInt<10, 100>(42).str()));
+  fmt::BasicFormatInt<16, 4> f(0xab);
+  EXPECT_EQ(4u, f.size());
+  EXPECT_EQ("00ab", std::string(f.data(), f.size()));
+  EXPECT_STREQ("00ab", f.c_str());
+}
+
+TEST(FormatDoubleTest, Shortest) {
+  EXPECT_EQ("0", fmt::FormatDouble(0).str());
+  EXPECT_EQ("0.1", fmt::FormatDouble(0.1).str());
+  EXPECT_EQ("-1.5", fmt::FormatDouble(-1.5).str());
+  EXPECT_EQ("1e+20", fmt::FormatDouble(1e20).str());
+  EXPECT_EQ("0.30000000000000004", fmt::FormatDouble(0.1 + 0.2).str());
+  double max = std::numeric_limits<double>::max();
+  EXPECT_EQ(max, std::strtod(fmt::FormatDouble(max).c_str(), 0));
+  fmt::FormatDouble f(42.25);
+  EXPECT_EQ(5u, f.size());
+  EXPECT_EQ("42.25", std::string(f.data(), f.size()));
+  EXPECT_STREQ("42.25", f.c_str());
+}
+
+TEST(FormatDoubleTest, Type) {
+  EXPECT_EQ("0.100", fmt::FormatDouble(0.1, 'f', 3).str());
+  EXPECT_EQ("392.650000", fmt::FormatDouble(392.65, 'f').str());
+  EXPECT_EQ("2", fmt::FormatDouble(1.5, 'f', 0).str());
+  EXPECT_EQ("1.50e+03", fmt::FormatDouble(1500, 'e', 2).str());
+  EXPECT_EQ("1.50E+03", fmt::FormatDouble(1500, 'E', 2).str());
+  EXPECT_EQ("1.2e+02", fmt::FormatDouble(123, 'g', 2).str());
+  double max = std::numeric_limits<double>::max();
+  int max_precision = fmt::FormatDouble::MAX_PRECISION;
+  EXPECT_EQ(format("{:.{}f}", max, max_precision),
+            fmt::FormatDouble(max, 'f', max_precision).str());
+  EXPECT_THROW_MSG(fmt::FormatDouble(1, 'd', 1), FormatError,
+                   "unknown format code 'd' for double");
+  EXPECT_THROW_MSG(fmt::FormatDouble(1, 'f', -1), FormatError,
+                   "negative precision");
+  EXPECT_THROW_MSG(fmt::FormatDouble(1, 'f', 65), FormatError,
+                   "precision is too big");
+}
+
+#if FMT_USE_CONSTEXPR && FMT_USE_VARIADIC_TEMPLATES
+enum StaticEnum { STATIC_ENUM_VALUE = -7 };
+
+TEST(StaticStringTest, CountDigits) {
+  static_assert(fmt::internal::static_count_digits(0) == 1, "");
+  static_assert(fmt::internal::static_count_digits(9999) == 4, "");
+  static_assert(fmt::internal::static_count_digits(10000) == 5, "");
+  for (unsigned i = 0; i < 20; ++i) {
+    uint64_t n = 1;
+    for (unsigned j = 0; j < i; ++j)
+      n *= 10;
+    EXPECT_EQ(fmt::internal::count_digits(n - 1),
+              fmt::internal::static_count_digits(n - 1));
+    EXPECT_EQ(fmt::internal::count_digits(n),
+              fmt::internal::static_count_digits(n));
+  }
+}
+
+TEST(StaticStringTest, StaticInt) {
+  EXPECT_STREQ("0", FMT_STATIC_INT(0).c_str());
+  EXPECT_STREQ("42", FMT_STATIC_INT(42).c_str());
+  EXPECT_STREQ("-42", FMT_STATIC_INT(-42).c_str());
+  EXPECT_STREQ("-7", FMT_STATIC_INT(STATIC_ENUM_VALUE).c_str());
+  EXPECT_EQ(fmt::format("{}", INT_MIN), FMT_STATIC_INT(INT_MIN).c_str());
+  EXPECT_EQ(fmt::format("{}", LLONG_MIN), FMT_STATIC_INT(LLONG_MIN).c_str());
+  EXPECT_EQ(fmt::format("{}", ULLONG_MAX),
+            FMT_STATIC_INT(ULLONG_MAX).c_str());
+  constexpr int value = 12345;
+  static_assert(FMT_STATIC_INT(value).size() == 5, "");
+}
+
+TEST(StaticStringTest, StaticStr) {
+  EXPECT_STREQ("", FMT_STATIC_STR("").c_str());
+  EXPECT_STREQ("abc", FMT_STATIC_STR("abc").c_str());
+  EXPECT_STREQ("{{a}}b{{", FMT_STATIC_STR("{a}b{").c_str());
+  static_assert(FMT_STATIC_STR("{a}").size() == 5, "");
+}
+
+TEST(StaticStringTest, Format) {
+  static constexpr auto MESSAGE = "limit " + FMT_STATIC_INT(100) +
+      " for " + FMT_STATIC_STR("{name}") + " exceeded: {}";
+  static_assert(MESSAGE.size() == 35, "");
+  EXPECT_EQ("limit 100 for {name} exceeded: 101", format(MESSAGE, 101));
+  EXPECT_EQ("-7 42", format(FMT_STATIC_INT(-7) + " {}", 42));
+}
+#endif
+
+TEST(BigIntTest, Format) {
+  uint64_t limbs64[] = {0, 1};
+  EXPECT_EQ("18446744073709551616", format("{}", fmt::BigInt(limbs64, 2)));
+  EXPECT_EQ("-18446744073709551616",
+            format("{}", fmt::BigInt(limbs64, 2, true)));
+  EXPECT_EQ("10000000000000000", format("{:x}", fmt::BigInt(limbs64, 2)));
+  uint32_t limbs32[] = {0, 0, 0, 0, 1, 0};
+  EXPECT_EQ("340282366920938463463374607431768211456",
+            format("{}", fmt::BigInt(limbs32, 6)));
+  EXPECT_EQ("0X100000000000000000000000000000000",
+            format("{:#X}", fmt::BigInt(limbs32, 6)));
+  EXPECT_EQ("0", format("{}", fmt::BigInt(limbs32, 0)));
+  EXPECT_EQ("0", format("{}", fmt::BigInt(limbs32, 3, true)));
+  EXPECT_EQ("0", format("{:x}", fmt::BigInt(limbs32, 3, true)));
+  uint32_t max[] = {0xffffffff, 0xffffffff};
+  EXPECT_EQ("18446744073709551615", format("{}", fmt::BigInt(max, 2)));
+  EXPECT_EQ("ffffffffffffffff", format("{:x}", fmt::BigInt(max, 2)));
+  uint32_t small[] = {42};
+  fmt::BigInt answer(small, 1);
+  EXPECT_EQ("   42", format("{:5}", answer));
+  EXPECT_EQ("42***", format("{:*<5}", answer));
+  EXPECT_EQ("+0042", format("{:+05}", answer));
+  EXPECT_EQ("-0042", format("{:05}", fmt::BigInt(small, 1, true)));
+  EXPECT_EQ("0x02a", format("{:#05x}", answer));
+  EXPECT_EQ("42", (MemoryWriter() << answer).str());
+#if FMT_USE_WCHAR
+  EXPECT_EQ(L" 42", format(L"{:3}", answer));
+#endif
+  EXPECT_EQ("[42]", format(fmt::ParsedFormat("[{}]"), answer));
+  EXPECT_THROW_MSG(format("{:.2}", answer),
+      FormatError, "precision not allowed in integer format specifier");
+  EXPECT_THROW_MSG(format("{:{}}", answer, 5),
+      FormatError, "nested width is not supported for this type");
+  EXPECT_THROW_MSG(format("{:f}", answer),
+      FormatError, "unknown format code 'f' for integer");
+}
+
+// Multiplies the number represented by limbs by 10 and adds digit.
+void mul10_add(std::vector<uint32_t> &limbs, unsigned digit) {
+  uint64_t carry = digit;
+  for (std::size_t i = 0; i < limbs.size(); ++i) {
+    uint64_t value = static_cast<uint64_t>(limbs[i]) * 10 + carry;
+    limbs[i] = static_cast<uint32_t>(value);
+    carry = value >> 32;
+  }
+  if (carry != 0)
+    limbs.push_back(static_cast<uint32_t>(carry));
+}
+
+TEST(BigIntTest, Decimal) {
+  // Parse decimal strings of various sizes into limbs and format them back.
+  std::srand(7);
+  for (int size = 1; size < 400; size += 7) {
+    std::string digits(1, static_cast<char>('1' + std::rand() % 9));
+    for (int i = 1; i < size; ++i) {
+      // Use runs of zeros to test padding of chunks.
+      char c = std::rand() % 3 == 0 ? '0' : '0' + std::rand() % 10;
+      digits += c;
+    }
+    std::vector<uint32_t> limbs(1);
+    for (std::size_t i = 0; i < digits.size(); ++i)
+      mul10_add(limbs, digits[i] - '0');
+    EXPECT_EQ(digits, format("{}", fmt::BigInt(&limbs[0], limbs.size())));
+  }
+  std::vector<uint32_t> limbs(1, 1);
+  for (int i = 0; i < 100; ++i)
+    mul10_add(limbs, 0);
+  EXPECT_EQ("1" + std::string(100, '0'),
+            format("{}", fmt::BigInt(&limbs[0], limbs.size())));
+}
+
 TEST(FormatTest, Print) {
 #if FMT_USE_FILE_DESCRIPTORS
   EXPECT_WRITE(stdout, fmt::print("Don't {}!", "panic"), "Don't panic!");
@@ -1446,7 +2188,9 @@ TEST(FormatTest, PrintColored) {
 
 TEST(FormatTest, Variadic) {
   EXPECT_EQ("abc1", format("{}c{}", "ab", 1));
+#if FMT_USE_WCHAR
   EXPECT_EQ(L"abc1", format(L"{}c{}", L"ab", 1));
+#endif
 }
 
 template <typename T>
@@ -1489,3 +2233,358 @@ TEST(FormatTest, MaxArgs) {
             fmt::format("{}{}{}{}{}{}{}{}{}{}{}{}{}{}{}",
                         0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 'a', 'b', 'c', 'd', 'e'));
 }
+
+TEST(ParsedFormatTest, Format) {
+  fmt::ParsedFormat f("{0} = {1:>6.2f}; {{{2:#x}}}");
+  EXPECT_EQ("pi =   3.14; {0x2a}", format(f, "pi", 3.14159, 42));
+  EXPECT_EQ("e =   2.72; {0x7}", format(f, "e", 2.71828, 7));
+  EXPECT_EQ("abc", format(fmt::ParsedFormat("abc")));
+  EXPECT_EQ("", format(fmt::ParsedFormat("")));
+#if FMT_USE_WCHAR
+  EXPECT_EQ(L"42 abc", format(fmt::WParsedFormat(L"{1} {0}"), L"abc", 42));
+#endif
+  MemoryWriter w;
+  w.write(f, "x", 1.0, 255);
+  EXPECT_EQ("x =   1.00; {0xff}", w.str());
+}
+
+TEST(ParsedFormatTest, NotNullTerminated) {
+  const char s[] = "{0:<4}|{1}!ignored";
+  fmt::ParsedFormat f(fmt::StringRef(s, 11));
+  EXPECT_EQ("ab  |cd!", format(f, "ab", "cd"));
+  EXPECT_THROW_MSG(fmt::ParsedFormat(fmt::StringRef(s, 5)),
+      FormatError, "missing '}' in format string");
+}
+
+TEST(ParsedFormatTest, RuntimePrecision) {
+  fmt::ParsedFormat f("{0:.{1}}");
+  EXPECT_EQ("1.23", format(f, 1.2345, 3));
+  EXPECT_EQ("1.2", format(f, 1.2345, 2u));
+  EXPECT_THROW_MSG(format(f, 1.2345, -1), FormatError, "negative precision");
+  EXPECT_THROW_MSG(format(f, 1.2345, "a"),
+      FormatError, "precision is not integer");
+  EXPECT_THROW_MSG(format(f, 42, 2),
+      FormatError, "precision not allowed in integer format specifier");
+  EXPECT_THROW_MSG(format(f, 1.2345),
+      FormatError, "argument index out of range");
+}
+
+TEST(ParsedFormatTest, RuntimeWidth) {
+  fmt::ParsedFormat f("{:{}}|{:0{}.{}}");
+  EXPECT_EQ("ab  |001.2", format(f, "ab", 4, 1.2345, 5, 2));
+  EXPECT_EQ("ab|1.2", format(f, "ab", 0u, 1.2345, 1ll, 2ull));
+  EXPECT_THROW_MSG(format(f, "ab", -1, 1.2345, 5, 2),
+      FormatError, "negative width");
+  EXPECT_THROW_MSG(format(f, "ab", "x", 1.2345, 5, 2),
+      FormatError, "width is not integer");
+  EXPECT_THROW_MSG(format(f, "ab", 4, 1.2345, 5),
+      FormatError, "argument index out of range");
+}
+
+TEST(ParsedFormatTest, DeferredChecks) {
+  fmt::ParsedFormat sign("{:+}");
+  EXPECT_EQ("+42", format(sign, 42));
+  EXPECT_THROW_MSG(format(sign, "abc"),
+      FormatError, "format specifier '+' requires numeric argument");
+  EXPECT_THROW_MSG(format(sign, 42u),
+      FormatError, "format specifier '+' requires signed argument");
+  EXPECT_THROW_MSG(format(fmt::ParsedFormat("{:#}"), "abc"),
+      FormatError, "format specifier '#' requires numeric argument");
+  EXPECT_THROW_MSG(format(fmt::ParsedFormat("{:.2}"), 42),
+      FormatError, "precision not allowed in integer format specifier");
+  EXPECT_THROW_MSG(format(fmt::ParsedFormat("{}{}"), 42),
+      FormatError, "argument index out of range");
+}
+
+TEST(ParsedFormatTest, ParseErrors) {
+  EXPECT_THROW_MSG(fmt::ParsedFormat("{"),
+      FormatError, "missing '}' in format string");
+  EXPECT_THROW_MSG(fmt::ParsedFormat("}"),
+      FormatError, "unmatched '}' in format string");
+  EXPECT_THROW_MSG(fmt::ParsedFormat("{0x}"),
+      FormatError, "missing '}' in format string");
+  EXPECT_THROW_MSG(fmt::ParsedFormat("{0}{}"),
+      FormatError, "cannot switch from manual to automatic argument indexing");
+  EXPECT_THROW_MSG(fmt::ParsedFormat("{}{0}"),
+      FormatError, "cannot switch from automatic to manual argument indexing");
+  EXPECT_THROW_MSG(fmt::ParsedFormat("{0:.}"),
+      FormatError, "missing precision specifier");
+  EXPECT_THROW_MSG(fmt::ParsedFormat("{0:.{1x}}"),
+      FormatError, "invalid format string");
+}
+
+TEST(ParsedFormatTest, CustomFormat) {
+  fmt::ParsedFormat f("{0} {0:>12}");
+  EXPECT_EQ("42 2012-12-9 ", format(fmt::ParsedFormat("{} {} "),
+                                  Answer(), Date(2012, 12, 9)));
+  EXPECT_EQ("2012-12-9    2012-12-9", format(f, Date(2012, 12, 9)));
+}
+
+struct Point {
+  int x, y;
+};
+
+int point_parse_count;
+
+namespace fmt {
+template <>
+struct Formatter<Point> {
+  typedef char ParsedSpec;
+
+  static ParsedSpec parse(const char *&s) {
+    ++point_parse_count;
+    return *s == 'x' || *s == 'y' ? *s++ : 0;
+  }
+
+  static void format(Writer &w, ParsedSpec spec, const Point &p) {
+    if (spec == 'x')
+      w << p.x;
+    else if (spec == 'y')
+      w << p.y;
+    else
+      w.write("({}, {})", p.x, p.y);
+  }
+};
+}
+
+TEST(FormatterTest, TwoPhaseCustomFormat) {
+  Point p = {1, 2};
+  EXPECT_EQ("(1, 2) 1 2", format("{0} {0:x} {1:y}", p, p));
+  EXPECT_EQ("(1, 2)", format("{:}", p));
+  EXPECT_THROW_MSG(format("{:z}", p),
+      FormatError, "missing '}' in format string");
+}
+
+TEST(ParsedFormatTest, TwoPhaseCustomFormat) {
+  Point p = {3, 4};
+  fmt::ParsedFormat f("{0:x},{0:y} {1}");
+  EXPECT_EQ("3,4 (0, 0)", format(f, p, Point()));
+  point_parse_count = 0;
+  Point q = {5, 6};
+  EXPECT_EQ("3,4 (5, 6)", format(f, p, q));
+  EXPECT_EQ(3, point_parse_count);
+  f.set_arg_type<Point>(0);
+  f.set_arg_type<Point>(1);
+  point_parse_count = 0;
+  EXPECT_EQ("3,4 (5, 6)", format(f, p, q));
+  EXPECT_EQ("3,4 (0, 0)", format(f, p, Point()));
+  EXPECT_EQ(0, point_parse_count);
+  // An argument of a different type is formatted as usual.
+  EXPECT_EQ("3,4 42", format(f, p, 42));
+  EXPECT_THROW_MSG(fmt::ParsedFormat("{:z}").set_arg_type<Point>(0),
+      FormatError, "missing '}' in format string");
+}
+
+TEST(RenderedFormatTest, Render) {
+  fmt::ParsedFormat f("cpu: {:3}% host: {} load: {:.2f}");
+  fmt::RenderedFormat r;
+  EXPECT_EQ("", r.str());
+  r.render(f, 42, "alpha", 0.5);
+  EXPECT_EQ("cpu:  42% host: alpha load: 0.50", r.str());
+  EXPECT_EQ(3u, r.num_updated_fields());
+  r.render(f, 42, "alpha", 0.5);
+  EXPECT_EQ(0u, r.num_updated_fields());
+  r.render(f, 7, "alpha", 0.5);
+  EXPECT_EQ("cpu:   7% host: alpha load: 0.50", r.str());
+  EXPECT_EQ(1u, r.num_updated_fields());
+  r.render(f, 7, "gamma-ray", 0.5);
+  EXPECT_EQ("cpu:   7% host: gamma-ray load: 0.50", r.str());
+  EXPECT_EQ(1u, r.num_updated_fields());
+  r.render(f, 1234, "b", 10.25);
+  EXPECT_EQ("cpu: 1234% host: b load: 10.25", r.str());
+  EXPECT_EQ(3u, r.num_updated_fields());
+  EXPECT_EQ(r.size(), std::string(r.data(), r.size()).size());
+}
+
+TEST(RenderedFormatTest, ModifiedString) {
+  fmt::ParsedFormat f("[{}] {}");
+  fmt::RenderedFormat r;
+  char name[] = "abc";
+  r.render(f, name, 1);
+  name[1] = 'x';
+  r.render(f, name, 1);
+  EXPECT_EQ("[axc] 1", r.str());
+  EXPECT_EQ(1u, r.num_updated_fields());
+  std::string s("long string");
+  r.render(f, s, 1);
+  EXPECT_EQ("[long string] 1", r.str());
+  s = "short";
+  r.render(f, s, 1);
+  EXPECT_EQ("[short] 1", r.str());
+}
+
+TEST(RenderedFormatTest, DynamicWidth) {
+  fmt::ParsedFormat f("{:{}}|{}");
+  fmt::RenderedFormat r;
+  r.render(f, 1, 3, 'x');
+  EXPECT_EQ("  1|x", r.str());
+  r.render(f, 1, 5, 'x');
+  EXPECT_EQ("    1|x", r.str());
+  EXPECT_EQ(1u, r.num_updated_fields());
+}
+
+TEST(RenderedFormatTest, FormatChange) {
+  fmt::ParsedFormat f1("{}-{}"), f2("{1}+{0}");
+  fmt::RenderedFormat r;
+  r.render(f1, 1, 2);
+  r.render(f2, 1, 2);
+  EXPECT_EQ("2+1", r.str());
+  EXPECT_EQ(2u, r.num_updated_fields());
+}
+
+TEST(RenderedFormatTest, NegativeZeroAndNaN) {
+  fmt::ParsedFormat f("{} {}");
+  fmt::RenderedFormat r;
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  r.render(f, 0.0, nan);
+  EXPECT_EQ("0 nan", r.str());
+  r.render(f, -0.0, nan);
+  EXPECT_EQ("-0 nan", r.str());
+  EXPECT_EQ(1u, r.num_updated_fields());
+  r.render(f, -0.0, nan);
+  EXPECT_EQ(0u, r.num_updated_fields());
+}
+
+TEST(RenderedFormatTest, FormatAtReusedAddress) {
+  fmt::RenderedFormat r;
+  {
+    fmt::ParsedFormat f("{}-{}");
+    r.render(f, 1, 2);
+  }
+  {
+    // A new format may be placed at the address of the destroyed one.
+    fmt::ParsedFormat f("{1}+{0}");
+    r.render(f, 1, 2);
+  }
+  EXPECT_EQ("2+1", r.str());
+  EXPECT_EQ(2u, r.num_updated_fields());
+}
+
+TEST(RenderedFormatTest, Error) {
+  fmt::ParsedFormat f("{}{:.{}}");
+  fmt::RenderedFormat r;
+  r.render(f, 1, 1.5, 1);
+  EXPECT_EQ("12", r.str());
+  EXPECT_THROW_MSG(r.render(f, 1, 1.5, -1),
+      FormatError, "negative precision");
+  r.render(f, 1, 1.5, 1);
+  EXPECT_EQ("12", r.str());
+  EXPECT_EQ(2u, r.num_updated_fields());
+}
+
+TEST(RenderedFormatTest, CustomArg) {
+  fmt::ParsedFormat f("{} {}");
+  fmt::RenderedFormat r;
+  Point p = {1, 2};
+  r.render(f, p, 42);
+  p.x = 3;
+  r.render(f, p, 42);
+  EXPECT_EQ("(3, 2) 42", r.str());
+  EXPECT_EQ(1u, r.num_updated_fields());
+}
+
+TEST(RenderedFormatTest, Random) {
+  fmt::ParsedFormat f("a{}bb{:>4}ccc{}{}d{:x}");
+  fmt::RenderedFormat r;
+  int values[5] = {};
+  std::srand(42);
+  for (int i = 0; i < 1000; ++i) {
+    values[std::rand() % 5] = std::rand() % 100000 - 50000;
+    if (std::rand() % 2 == 0)
+      values[std::rand() % 5] = std::rand() % 10;
+    r.render(f, values[0], values[1], values[2], values[3], values[4]);
+    ASSERT_EQ(format("a{}bb{:>4}ccc{}{}d{:x}", values[0], values[1],
+                     values[2], values[3], values[4]), r.str());
+  }
+}
+
+#if FMT_USE_WCHAR
+TEST(RenderedFormatTest, WideString) {
+  fmt::WParsedFormat f(L"{} {}");
+  fmt::WRenderedFormat r;
+  r.render(f, L"abc", 1);
+  r.render(f, L"abcdef", 1);
+  EXPECT_EQ(L"abcdef 1", r.str());
+  EXPECT_EQ(1u, r.num_updated_fields());
+}
+#endif
+
+TEST(DynamicArgListTest, Format) {
+  fmt::DynamicArgList args;
+  EXPECT_EQ(0u, args.size());
+  EXPECT_EQ("no args", format("no args", args.args()));
+  args.push_back(42);
+  args.push_back("abc");
+  args.push_back(1.5);
+  std::string s = "str";
+  args.push_back(s);
+  args.push_back('x');
+  EXPECT_EQ(5u, args.size());
+  EXPECT_EQ("42 abc 1.50 str x", format("{} {} {:.2f} {} {}", args.args()));
+  EXPECT_EQ("x 42", format("{4} {0}", args.args()));
+  EXPECT_THROW_MSG(format("{5}", args.args()),
+      FormatError, "argument index out of range");
+  EXPECT_EQ("42 abc", fmt::sprintf("%d %s", args.args()));
+}
+
+TEST(DynamicArgListTest, Formatter) {
+  fmt::DynamicArgList args;
+  args.push_back(1);
+  args.push_back(2);
+  MemoryWriter w;
+  fmt::BasicFormatter<char> formatter(w);
+  formatter.format("{}+{}", args.args());
+  EXPECT_EQ("1+2", w.str());
+}
+
+TEST(DynamicArgListTest, ManyArgs) {
+  // Check every count around the packed argument limit.
+  for (int n = 1; n < 40; ++n) {
+    fmt::DynamicArgList args;
+    std::string format_str, expected;
+    for (int i = 0; i < n; ++i) {
+      args.push_back(i);
+      format_str += "{}";
+      expected += format("{}", i);
+    }
+    EXPECT_EQ(expected, format(format_str, args.args()));
+    EXPECT_THROW_MSG(format(format_str + "{}", args.args()),
+        FormatError, "argument index out of range");
+  }
+}
+
+TEST(DynamicArgListTest, CopyStrings) {
+  fmt::DynamicArgList args;
+  std::string expected, format_str;
+  for (int i = 0; i < 100; ++i) {
+    // The temporary is destroyed immediately.
+    args.push_back_copy(format("string{}", i));
+    args.push_back(i);
+    format_str += "{} {},";
+    expected += format("string{} {},", i, i);
+  }
+  EXPECT_EQ(expected, format(format_str, args.args()));
+  args.clear();
+  EXPECT_EQ(0u, args.size());
+  args.push_back_copy(std::string("abc"));
+  EXPECT_EQ("abc", format("{}", args.args()));
+}
+
+TEST(DynamicArgListTest, CustomType) {
+  Point p = {1, 2};
+  fmt::DynamicArgList args;
+  Date d(2015, 3, 7);
+  args.push_back(p);
+  args.push_back(d);
+  EXPECT_EQ("1 2015-3-7", format("{0:x} {1}", args.args()));
+}
+
+#if FMT_USE_WCHAR
+TEST(DynamicArgListTest, WChar) {
+  fmt::WDynamicArgList args;
+  args.push_back(L"abc");
+  args.push_back_copy(std::wstring(L"def"));
+  args.push_back(42);
+  EXPECT_EQ(L"abc def 42", format(L"{} {} {}", args.args()));
+}
+#endif
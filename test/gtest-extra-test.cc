@@ -27,6 +27,7 @@
 
 #include "gtest-extra.h"
 
+#include <cstdio>
 #include <cstring>
 #include <algorithm>
 #include <stdexcept>
@@ -40,6 +41,19 @@
 # undef fileno
 #endif
 
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sched.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/socket.h>
+# include <sys/wait.h>
+#endif
+
+#if FMT_USE_ZLIB
+# include <zlib.h>
+#endif
+
 namespace {
 
 #if defined(_WIN32) && !defined(__MINGW32__)
@@ -674,6 +688,58 @@ TEST(FileTest, WriteError) {
   EXPECT_SYSTEM_ERROR(read_end.write(" ", 1), EBADF, "cannot write to file");
 }
 
+TEST(FileTest, WriteNoExcept) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  ErrorCode ec;
+  EXPECT_EQ(4u, write_end.write("test", 4, ec));
+  EXPECT_EQ(0, ec.get());
+  write_end.close();
+  EXPECT_READ(read_end, "test");
+}
+
+TEST(FileTest, WriteNoExceptError) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  ErrorCode ec;
+  SUPPRESS_ASSERT(EXPECT_EQ(0u, read_end.write(" ", 1, ec)));
+  EXPECT_EQ(EBADF, ec.get());
+}
+
+TEST(FileTest, WriteGather) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  std::string payload(5000, 'x');
+  fmt::GatherWriter w;
+  w.write("{}: {}\n", "payload", fmt::ref(payload));
+  write_end.write(w);
+  write_end.close();
+  EXPECT_READ(read_end, ("payload: " + payload + "\n").c_str());
+}
+
+TEST(FileTest, WriteGatherManySegments) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  std::string payload(10, 'x'), expected;
+  fmt::GatherWriter w(10);
+  for (int i = 0; i < 100; ++i) {
+    w.write("{}{}", i, fmt::ref(payload));
+    expected += fmt::format("{}{}", i, payload);
+  }
+  EXPECT_EQ(201u, w.num_segments());
+  write_end.write(w);
+  write_end.close();
+  EXPECT_READ(read_end, expected.c_str());
+}
+
+TEST(FileTest, WriteGatherError) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  fmt::GatherWriter w;
+  w << "test";
+  EXPECT_SYSTEM_ERROR(read_end.write(w), EBADF, "cannot write to file");
+}
+
 TEST(FileTest, Dup) {
   File f = open_file();
   File copy = File::dup(f.descriptor());
@@ -833,6 +899,657 @@ TEST(OutputRedirectTest, ErrorInDtor) {
   write_copy.dup2(write_fd); // "undo" close or dtor of BufferedFile will fail
 }
 
+// Writes content to a file with the specified name.
+void write_file(fmt::StringRef filename, fmt::StringRef content) {
+  BufferedFile f(filename, "w");
+  std::fwrite(content.c_str(), 1, content.size(), f.get());
+}
+
+TEST(MessageCatalogTest, Format) {
+  write_file("test-catalog",
+    "# A comment.\n"
+    "42 {} took {:.2f} seconds\n"
+    "\n"
+    "7 {1}, {0}!\r\n"
+    "100 no arguments");
+  fmt::MessageCatalog catalog("test-catalog");
+  EXPECT_EQ(3u, catalog.size());
+  EXPECT_TRUE(catalog.contains(7));
+  EXPECT_FALSE(catalog.contains(8));
+  EXPECT_EQ("query took 1.50 seconds", format(catalog, 42, "query", 1.5));
+  EXPECT_EQ("Hello, world!", format(catalog, 7, "world", "Hello"));
+  EXPECT_EQ("no arguments", format(catalog, 100));
+  fmt::MemoryWriter w;
+  catalog.write(w, 100, fmt::ArgList());
+  EXPECT_EQ("no arguments", w.str());
+  EXPECT_THROW_MSG(format(catalog, 8), fmt::FormatError,
+      "unknown message id 8");
+  EXPECT_THROW_MSG(format(catalog, 42, "query", 1), fmt::FormatError,
+      "precision not allowed in integer format specifier");
+}
+
+TEST(MessageCatalogTest, EmptyFile) {
+  write_file("test-catalog", "");
+  fmt::MessageCatalog catalog("test-catalog");
+  EXPECT_EQ(0u, catalog.size());
+}
+
+TEST(MessageCatalogTest, Errors) {
+  EXPECT_SYSTEM_ERROR(fmt::MessageCatalog("nonexistent"), ENOENT,
+      "cannot open file nonexistent");
+  write_file("test-catalog", "1 ok\nx invalid\n");
+  EXPECT_THROW_MSG(fmt::MessageCatalog("test-catalog"), fmt::FormatError,
+      "invalid message id at line 2");
+  write_file("test-catalog", "1 ok\n\n1 again");
+  EXPECT_THROW_MSG(fmt::MessageCatalog("test-catalog"), fmt::FormatError,
+      "duplicate message id 1");
+  write_file("test-catalog", "1 {0");
+  EXPECT_THROW_MSG(fmt::MessageCatalog("test-catalog"), fmt::FormatError,
+      "missing '}' in format string at line 1");
+  write_file("test-catalog", "99999999999 x");
+  EXPECT_THROW_MSG(fmt::MessageCatalog("test-catalog"), fmt::FormatError,
+      "message id too big at line 1");
+}
+
+TEST(TeeWriterTest, Print) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  fmt::FileSink file_sink(write_end);
+  fmt::MemoryWriter w;
+  fmt::WriterSink writer_sink(w);
+  fmt::StdioSink stdio_sink(stdout);
+  fmt::TeeWriter tee;
+  tee.add_sink(file_sink, "[log] ", "\n");
+  tee.add_sink(writer_sink);
+  tee.add_sink(stdio_sink, fmt::RED);
+  EXPECT_EQ(3u, tee.num_sinks());
+  EXPECT_WRITE(stdout, tee.print("Don't {}!", "panic"),
+      "\x1b[31mDon't panic!\x1b[0m");
+  EXPECT_WRITE(stdout, tee.print("{}{}", 4, 2), "\x1b[31m42\x1b[0m");
+  write_end.close();
+  EXPECT_READ(read_end, "[log] Don't panic!\n[log] 42\n");
+  EXPECT_EQ("Don't panic!42", w.str());
+}
+
+TEST(TeeWriterTest, PrintError) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  fmt::FileSink sink(read_end);
+  fmt::TeeWriter tee;
+  tee.add_sink(sink);
+  EXPECT_THROW(tee.print("test"), fmt::SystemError);
+  EXPECT_THROW_MSG(tee.print("{"), fmt::FormatError,
+      "invalid format string");
+}
+
+#ifndef _WIN32
+void set_nonblocking(File &f) {
+  int flags = fcntl(f.descriptor(), F_GETFL);
+  ASSERT_NE(-1, flags);
+  ASSERT_NE(-1, fcntl(f.descriptor(), F_SETFL, flags | O_NONBLOCK));
+}
+
+// Reads from f until count bytes are read.
+std::string read_exactly(File &f, std::size_t count) {
+  std::string result(count, '\0');
+  for (std::size_t offset = 0; offset != count; ) {
+    std::size_t n = f.read(&result[offset], count - offset);
+    if (n == 0)
+      break;
+    offset += n;
+  }
+  return result;
+}
+
+TEST(NonBlockingWriterTest, Flush) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  set_nonblocking(write_end);
+  fmt::NonBlockingWriter w(write_end);
+  EXPECT_EQ(0u, w.pending());
+  EXPECT_TRUE(w.flush());
+  w.write("Don't {}!", "panic");
+  EXPECT_EQ(12u, w.pending());
+  EXPECT_TRUE(w.flush());
+  EXPECT_EQ(0u, w.pending());
+  w << 42;
+  EXPECT_TRUE(w.flush());
+  write_end.close();
+  EXPECT_READ(read_end, "Don't panic!42");
+}
+
+// Writes more output than fits into the pipe and checks that it is
+// flushed in parts as the reader makes room for it.
+TEST(NonBlockingWriterTest, PartialFlush) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  set_nonblocking(write_end);
+  fmt::NonBlockingWriter w(write_end);
+  fmt::MemoryWriter expected;
+  for (int i = 0; i < 100000; ++i) {
+    w.write("{:08x}\n", i);
+    expected.write("{:08x}\n", i);
+  }
+  EXPECT_FALSE(w.flush());
+  std::size_t num_pending = w.pending();
+  EXPECT_GT(num_pending, 0u);
+  EXPECT_LT(num_pending, expected.size());
+  std::string output;
+  for (int i = 0; ; ++i) {
+    // Output is appended while previous output is pending.
+    if (i < 10) {
+      w.write("extra{}\n", i);
+      expected.write("extra{}\n", i);
+    }
+    std::size_t num_written = expected.size() - output.size() - w.pending();
+    output += read_exactly(read_end, num_written);
+    if (w.flush() && i >= 10)
+      break;
+  }
+  output += read_exactly(read_end, expected.size() - output.size());
+  EXPECT_EQ(expected.str(), output);
+}
+
+TEST(NonBlockingWriterTest, Socket) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  File a(File::dup(fds[0])), b(File::dup(fds[1]));
+  ::close(fds[0]);
+  ::close(fds[1]);
+  set_nonblocking(a);
+  fmt::NonBlockingWriter w(a);
+  std::string payload(1000000, 'x');
+  w << payload;
+  EXPECT_FALSE(w.flush());
+  std::size_t num_written = payload.size() - w.pending();
+  std::string output = read_exactly(b, num_written);
+  while (!w.flush()) {
+    std::size_t n = payload.size() - w.pending() - num_written;
+    output += read_exactly(b, n);
+    num_written += n;
+  }
+  output += read_exactly(b, payload.size() - num_written);
+  EXPECT_EQ(payload, output);
+}
+
+TEST(NonBlockingWriterTest, ShortenThroughBase) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  set_nonblocking(write_end);
+  fmt::NonBlockingWriter w(write_end);
+  std::string payload(200000, 'x');
+  w << payload;
+  EXPECT_FALSE(w.flush());
+  std::size_t num_written = payload.size() - w.pending();
+  // The output that has been written to the pipe can't be discarded.
+  fmt::Writer &base = w;
+  base.rollback(0);
+  EXPECT_EQ(0u, w.pending());
+  w << "abc";
+  EXPECT_EQ(3u, w.pending());
+  base.clear();
+  EXPECT_EQ(0u, w.pending());
+  w << "end";
+  EXPECT_EQ(std::string(num_written, 'x'), read_exactly(read_end, num_written));
+  EXPECT_TRUE(w.flush());
+  EXPECT_EQ("end", read_exactly(read_end, 3));
+}
+
+TEST(NonBlockingWriterTest, FlushError) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  fmt::NonBlockingWriter w(read_end);
+  w << "test";
+  EXPECT_SYSTEM_ERROR(w.flush(), EBADF, "cannot write to file");
+  EXPECT_EQ(4u, w.pending());
+  w.clear();
+  EXPECT_EQ(0u, w.pending());
+  EXPECT_TRUE(w.flush());
+}
+
+# ifdef __linux__
+TEST(PipeWriterTest, Flush) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  {
+    fmt::PipeWriter w(write_end);
+    w.print("Don't {}!", "panic");
+    w << 42;
+    w.flush();
+    w.flush();
+    w.print("{}", '\n');
+  }
+  write_end.close();
+  EXPECT_READ(read_end, "Don't panic!42");
+}
+
+// Checks that the chunks are not reused while the pipe holds their pages.
+TEST(PipeWriterTest, NoReuseOfUnreadChunks) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  fmt::MemoryWriter expected;
+  fmt::PipeWriter w(write_end, 8192);
+  for (int i = 0; i < 2000; ++i) {
+    w.print("{:010}\n", i);
+    expected.write("{:010}\n", i);
+  }
+  w.flush();
+  EXPECT_EQ(expected.str(), read_exactly(read_end, expected.size()));
+}
+
+// Checks that the output is correct when chunks are recycled.
+TEST(PipeWriterTest, Recycle) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  fmt::PipeWriter w(write_end, 8192);
+  fmt::MemoryWriter expected;
+  std::string output;
+  for (int i = 0; i < 100000; ++i) {
+    std::size_t size = expected.size();
+    w.print("{} {}\n", i, i * 0.5);
+    expected.write("{} {}\n", i, i * 0.5);
+    if (i % 1000 == 999) {
+      // Keep a part of the output in the pipe while writing more.
+      w.flush();
+      output += read_exactly(read_end, size - output.size());
+    }
+  }
+  w.flush();
+  output += read_exactly(read_end, expected.size() - output.size());
+  EXPECT_EQ(expected.str(), output);
+}
+
+TEST(PipeWriterTest, LongMessage) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  fmt::PipeWriter w(write_end, 4096);
+  std::string s(50000, 'x');
+  w.print("<{}>", s);
+  w.flush();
+  EXPECT_EQ("<" + s + ">", read_exactly(read_end, s.size() + 2));
+}
+
+TEST(PipeWriterTest, NotPipe) {
+  File f("/dev/null", File::WRONLY);
+  fmt::PipeWriter w(f);
+  w << "test";
+  EXPECT_SYSTEM_ERROR(w.flush(), EBADF, "cannot write to pipe");
+}
+# endif  // __linux__
+
+// A shared memory object that is removed when the test finishes.
+class SharedMemory {
+ private:
+  std::string name_;
+
+ public:
+  SharedMemory() : name_(fmt::format("/fmt-test-{}", getpid())) {
+    shm_unlink(name_.c_str());
+  }
+  ~SharedMemory() { shm_unlink(name_.c_str()); }
+
+  File open() const { return File::open_shared(name_); }
+};
+
+TEST(LogRingTest, PrintRead) {
+  SharedMemory shm;
+  File f = shm.open();
+  fmt::LogRing ring(f, 4, 64);
+  EXPECT_EQ(48u, ring.max_record_size());
+  fmt::MemoryWriter w;
+  EXPECT_FALSE(ring.read(w));
+  EXPECT_TRUE(ring.print("{} {}", "answer", 42));
+  EXPECT_TRUE(ring.print("second"));
+  bool truncated = true;
+  EXPECT_TRUE(ring.read(w, &truncated));
+  EXPECT_FALSE(truncated);
+  EXPECT_EQ("answer 42", w.str());
+  EXPECT_TRUE(ring.read(w));
+  EXPECT_EQ("answer 42second", w.str());
+  EXPECT_FALSE(ring.read(w));
+}
+
+TEST(LogRingTest, Full) {
+  SharedMemory shm;
+  File f = shm.open();
+  fmt::LogRing ring(f, 3, 20);
+  EXPECT_EQ(8u, ring.max_record_size());
+  for (int i = 0; i < 4; ++i)
+    EXPECT_TRUE(ring.print("{}", i));
+  EXPECT_FALSE(ring.print("dropped"));
+  EXPECT_FALSE(ring.print("dropped"));
+  EXPECT_EQ(2u, ring.num_dropped());
+  fmt::MemoryWriter w;
+  EXPECT_TRUE(ring.read(w));
+  EXPECT_TRUE(ring.print("{}", 4));
+  EXPECT_FALSE(ring.print("dropped"));
+  while (ring.read(w)) {}
+  EXPECT_EQ("01234", w.str());
+  EXPECT_EQ(3u, ring.num_dropped());
+}
+
+TEST(LogRingTest, Truncate) {
+  SharedMemory shm;
+  File f = shm.open();
+  fmt::LogRing ring(f, 4, 32);
+  EXPECT_TRUE(ring.print("{}", std::string(100, 'x')));
+  EXPECT_TRUE(ring.print("{}", std::string(16, 'y')));
+  fmt::MemoryWriter w;
+  bool truncated = false;
+  EXPECT_TRUE(ring.read(w, &truncated));
+  EXPECT_TRUE(truncated);
+  EXPECT_EQ(std::string(16, 'x'), w.str());
+  w.clear();
+  EXPECT_TRUE(ring.read(w, &truncated));
+  EXPECT_FALSE(truncated);
+  EXPECT_EQ(std::string(16, 'y'), w.str());
+}
+
+TEST(LogRingTest, FormatError) {
+  SharedMemory shm;
+  File f = shm.open();
+  fmt::LogRing ring(f, 4, 64);
+  EXPECT_THROW_MSG(ring.print("{"), fmt::FormatError, "invalid format string");
+  EXPECT_TRUE(ring.print("test"));
+  fmt::MemoryWriter w;
+  EXPECT_TRUE(ring.read(w));
+  EXPECT_EQ("test", w.str());
+  EXPECT_FALSE(ring.read(w));
+}
+
+TEST(LogRingTest, Attach) {
+  SharedMemory shm;
+  File f = shm.open();
+  fmt::LogRing ring(f, 4, 64);
+  ring.print("test");
+  // The parameters of an existing ring are taken from the file.
+  File other_file = shm.open();
+  fmt::LogRing other(other_file, 1024, 256);
+  EXPECT_EQ(48u, other.max_record_size());
+  fmt::MemoryWriter w;
+  EXPECT_TRUE(other.read(w));
+  EXPECT_EQ("test", w.str());
+  EXPECT_FALSE(ring.read(w));
+}
+
+TEST(LogRingTest, Invalid) {
+  SharedMemory shm;
+  File f = shm.open();
+  f.resize(100);
+  EXPECT_SYSTEM_ERROR(fmt::LogRing ring(f), EINVAL, "invalid log ring");
+  f.resize(65536);
+  f.write("junk", 4);
+  EXPECT_SYSTEM_ERROR(fmt::LogRing ring(f), EINVAL, "invalid log ring");
+}
+
+struct Crash {};
+
+std::ostream &operator<<(std::ostream &os, Crash) {
+  _exit(0);
+  return os;
+}
+
+TEST(LogRingTest, CrashedProducer) {
+  SharedMemory shm;
+  File f = shm.open();
+  fmt::LogRing ring(f, 4, 64);
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    ring.print("before crash");
+    ring.print("{}", Crash());
+    _exit(1);
+  }
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  fmt::MemoryWriter w;
+  EXPECT_TRUE(ring.read(w));
+  EXPECT_EQ("before crash", w.str());
+  // The record that the producer has started writing is not committed.
+  EXPECT_FALSE(ring.read(w));
+  EXPECT_TRUE(ring.skip());
+  EXPECT_FALSE(ring.skip());
+  EXPECT_TRUE(ring.print("after crash"));
+  w.clear();
+  EXPECT_TRUE(ring.read(w));
+  EXPECT_EQ("after crash", w.str());
+}
+
+// A type whose formatting is interrupted by the collector skipping the
+// record being written.
+struct Skipped {
+  fmt::LogRing *ring;
+};
+
+void format(fmt::BasicFormatter<char> &f, const char *&format_str,
+            const Skipped &s) {
+  EXPECT_TRUE(s.ring->skip());
+  f.writer() << "skipped";
+  if (*format_str == ':')
+    ++format_str;
+  if (*format_str == '}')
+    ++format_str;
+}
+
+TEST(LogRingTest, SkipLiveProducer) {
+  SharedMemory shm;
+  File f = shm.open();
+  fmt::LogRing ring(f, 4, 64);
+  Skipped skipped = {&ring};
+  EXPECT_FALSE(ring.print("{}", skipped));
+  EXPECT_EQ(1u, ring.num_dropped());
+  fmt::MemoryWriter w;
+  EXPECT_FALSE(ring.read(w));
+  EXPECT_TRUE(ring.print("next"));
+  EXPECT_TRUE(ring.read(w));
+  EXPECT_EQ("next", w.str());
+}
+
+TEST(LogRingTest, MultipleProducers) {
+  enum { NUM_PRODUCERS = 4, NUM_RECORDS = 2000 };
+  SharedMemory shm;
+  File f = shm.open();
+  fmt::LogRing ring(f, 64, 64);
+  pid_t pids[NUM_PRODUCERS] = {};
+  for (int i = 0; i < NUM_PRODUCERS; ++i) {
+    pids[i] = fork();
+    ASSERT_NE(-1, pids[i]);
+    if (pids[i] == 0) {
+      for (int j = 0; j < NUM_RECORDS; ++j) {
+        while (!ring.print("{} {}", i, j))
+          sched_yield();
+      }
+      _exit(0);
+    }
+  }
+  int next[NUM_PRODUCERS] = {};
+  fmt::MemoryWriter w;
+  for (int count = 0; count != NUM_PRODUCERS * NUM_RECORDS; ) {
+    w.clear();
+    if (!ring.read(w)) {
+      sched_yield();
+      continue;
+    }
+    int producer = -1, record = -1;
+    ASSERT_EQ(2, std::sscanf(w.c_str(), "%d %d", &producer, &record));
+    ASSERT_TRUE(producer >= 0 && producer < NUM_PRODUCERS);
+    // Records of each producer are read in order.
+    ASSERT_EQ(next[producer], record);
+    ++next[producer];
+    ++count;
+  }
+  for (int i = 0; i < NUM_PRODUCERS; ++i) {
+    int status = 0;
+    EXPECT_EQ(pids[i], waitpid(pids[i], &status, 0));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+  }
+  EXPECT_FALSE(ring.read(w));
+}
+
+std::string read_file(const char *filename) {
+  File f(filename, File::RDONLY);
+  return read_exactly(f, static_cast<std::size_t>(f.size()));
+}
+
+// Decompresses an LZ4 frame with independent blocks. The end mark is
+// optional to allow decompressing the output of a stream that has been
+// flushed but not finished.
+std::string lz4_decompress(const std::string &frame) {
+  const unsigned char *p = reinterpret_cast<const unsigned char*>(
+        frame.data()) + 7;
+  const unsigned char *end = p + frame.size() - 7;
+  std::string result;
+  while (end - p >= 4) {
+    uint32_t size = p[0] | (p[1] << 8) | (p[2] << 16) |
+        (static_cast<uint32_t>(p[3]) << 24);
+    p += 4;
+    if (size == 0)
+      break;
+    if ((size & 0x80000000u) != 0) {
+      size &= 0x7fffffffu;
+      result.append(reinterpret_cast<const char*>(p), size);
+      p += size;
+      continue;
+    }
+    const unsigned char *block_end = p + size;
+    std::size_t block_start = result.size();
+    for (;;) {
+      unsigned token = *p++;
+      std::size_t n = token >> 4;
+      if (n == 15) {
+        for (unsigned char c = 255; c == 255; n += c)
+          c = *p++;
+      }
+      result.append(reinterpret_cast<const char*>(p), n);
+      p += n;
+      if (p >= block_end)
+        break;
+      std::size_t offset = p[0] | (p[1] << 8);
+      p += 2;
+      EXPECT_TRUE(offset != 0 && offset <= result.size() - block_start);
+      std::size_t length = token & 15;
+      if (length == 15) {
+        for (unsigned char c = 255; c == 255; length += c)
+          c = *p++;
+      }
+      length += 4;
+      for (std::size_t i = 0, from = result.size() - offset; i < length; ++i)
+        result.push_back(result[from + i]);
+    }
+  }
+  return result;
+}
+
+TEST(CompressedFileSinkTest, LZ4Header) {
+  {
+    File f("test-file", File::WRONLY | O_CREAT | O_TRUNC);
+    fmt::CompressedFileSink sink(f);
+  }
+  EXPECT_EQ(std::string("\x04\x22\x4d\x18\x60\x40\x82\0\0\0\0", 11),
+            read_file("test-file"));
+  {
+    File f("test-file", File::WRONLY | O_CREAT | O_TRUNC);
+    fmt::CompressedFileSink sink(f, fmt::CompressedFileSink::LZ4, 100000);
+  }
+  EXPECT_EQ(0x50, read_file("test-file")[5]);
+}
+
+TEST(CompressedFileSinkTest, LZ4) {
+  fmt::MemoryWriter w;
+  {
+    File f("test-file", File::WRONLY | O_CREAT | O_TRUNC);
+    fmt::CompressedFileSink sink(f);
+    fmt::WriterSink writer_sink(w);
+    fmt::TeeWriter out;
+    out.add_sink(sink);
+    out.add_sink(writer_sink);
+    for (int i = 0; i < 50000; ++i)
+      out.print("{:<10} {:>8} {:10.3f}\n", "row", i, i * 0.5);
+    sink.finish();
+  }
+  std::string compressed = read_file("test-file");
+  EXPECT_LT(compressed.size(), w.size() / 3);
+  EXPECT_EQ(w.str(), lz4_decompress(compressed));
+}
+
+TEST(CompressedFileSinkTest, LZ4Incompressible) {
+  std::string data(200000, ' ');
+  uint32_t state = 42;
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    state = state * 1103515245u + 12345u;
+    data[i] = static_cast<char>(state >> 24);
+  }
+  {
+    File f("test-file", File::WRONLY | O_CREAT | O_TRUNC);
+    fmt::CompressedFileSink sink(f);
+    sink.write(data.data(), 100);
+    sink.write(data.data() + 100, data.size() - 100);
+  }
+  std::string compressed = read_file("test-file");
+  // The blocks are stored uncompressed.
+  EXPECT_EQ(7 + 4 * 4 + data.size() + 4, compressed.size());
+  EXPECT_EQ(data, lz4_decompress(compressed));
+}
+
+TEST(CompressedFileSinkTest, Flush) {
+  File f("test-file", File::WRONLY | O_CREAT | O_TRUNC);
+  fmt::CompressedFileSink sink(f);
+  sink.write("abc", 3);
+  EXPECT_EQ("", lz4_decompress(read_file("test-file")));
+  sink.flush();
+  EXPECT_EQ("abc", lz4_decompress(read_file("test-file")));
+  sink.write("def", 3);
+  sink.finish();
+  sink.finish();
+  std::string compressed = read_file("test-file");
+  EXPECT_EQ("abcdef", lz4_decompress(compressed));
+  EXPECT_EQ(std::string(4, '\0'), compressed.substr(compressed.size() - 4));
+}
+
+TEST(CompressedFileSinkTest, WriteError) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  EXPECT_THROW(fmt::CompressedFileSink sink(read_end), fmt::SystemError);
+}
+
+#if FMT_USE_ZLIB
+TEST(CompressedFileSinkTest, GZIP) {
+  fmt::MemoryWriter w;
+  {
+    File f("test-file", File::WRONLY | O_CREAT | O_TRUNC);
+    fmt::CompressedFileSink sink(f, fmt::CompressedFileSink::GZIP, 4096);
+    fmt::WriterSink writer_sink(w);
+    fmt::TeeWriter out;
+    out.add_sink(sink);
+    out.add_sink(writer_sink);
+    for (int i = 0; i < 50000; ++i)
+      out.print("{:<10} {:>8} {:10.3f}\n", "row", i, i * 0.5);
+  }
+  std::string compressed = read_file("test-file");
+  EXPECT_LT(compressed.size(), w.size() / 3);
+  std::string data(w.size() + 1, '\0');
+  z_stream stream = z_stream();
+  ASSERT_EQ(Z_OK, inflateInit2(&stream, MAX_WBITS + 16));
+  stream.next_in = reinterpret_cast<Bytef*>(&compressed[0]);
+  stream.avail_in = static_cast<uInt>(compressed.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&data[0]);
+  stream.avail_out = static_cast<uInt>(data.size());
+  EXPECT_EQ(Z_STREAM_END, inflate(&stream, Z_FINISH));
+  data.resize(data.size() - stream.avail_out);
+  inflateEnd(&stream);
+  EXPECT_EQ(w.str(), data);
+}
+#else
+TEST(CompressedFileSinkTest, NoZlib) {
+  File f("test-file", File::WRONLY | O_CREAT | O_TRUNC);
+  EXPECT_THROW_MSG(
+        fmt::CompressedFileSink(f, fmt::CompressedFileSink::GZIP),
+        std::runtime_error, "zlib is not available");
+}
+#endif
+#endif
+
 #endif  // FMT_USE_FILE_DESCRIPTORS
 
 }  // namespace
@@ -34,6 +34,11 @@
 #include <fcntl.h>
 #include <climits>
 
+#ifndef _WIN32
+# include <sys/mman.h>
+# include <sys/uio.h>
+#endif
+
 #ifdef _WIN32
 # include <io.h>
 # undef max
@@ -54,12 +59,14 @@ int dup2_count;
 int fdopen_count;
 int read_count;
 int write_count;
+int writev_count;
 int pipe_count;
 int fopen_count;
 int fclose_count;
 int fileno_count;
 std::size_t read_nbyte;
 std::size_t write_nbyte;
+std::size_t writev_max_bytes;
 bool sysconf_error;
 
 enum FStatSimulation { NONE, MAX_SIZE, ERROR } fstat_sim;
@@ -96,6 +103,29 @@ long test::sysconf(int name) {
   errno = EINVAL;
   return -1;
 }
+
+void *test::mmap(
+    void *addr, size_t len, int prot, int flags, int fd, off_t off) {
+  return ::mmap(addr, len, prot, flags, fd, off);
+}
+
+int test::munmap(void *addr, size_t len) { return ::munmap(addr, len); }
+
+test::ssize_t test::writev(int fildes, const struct iovec *iov, int iovcnt) {
+  EMULATE_EINTR(writev, -1);
+  if (writev_max_bytes == 0)
+    return ::writev(fildes, iov, iovcnt);
+  // Simulate a partial write.
+  std::size_t num_bytes = 0;
+  for (int i = 0; i < iovcnt && num_bytes < writev_max_bytes; ++i) {
+    std::size_t size = iov[i].iov_len;
+    if (size > writev_max_bytes - num_bytes)
+      size = writev_max_bytes - num_bytes;
+    ::write(fildes, iov[i].iov_base, size);
+    num_bytes += size;
+  }
+  return num_bytes;
+}
 #else
 errno_t test::sopen_s(
     int* pfh, const char *filename, int oflag, int shflag, int pmode) {
@@ -314,6 +344,60 @@ TEST(FileTest, WriteRetry) {
 #endif
 }
 
+TEST(FileTest, WriteNoExceptRetry) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  ErrorCode ec;
+  std::size_t count = 0;
+  write_count = 1;
+  count = write_end.write("test", 4, ec);
+#ifndef _WIN32
+  EXPECT_EQ(4, write_count);
+  EXPECT_EQ(4u, count);
+#else
+  EXPECT_EQ(EINTR, ec.get());
+  EXPECT_EQ(0u, count);
+#endif
+  write_count = 0;
+}
+
+#ifndef _WIN32
+std::string read_all(File &f) {
+  std::string content;
+  char buffer[256];
+  while (std::size_t count = f.read(buffer, sizeof(buffer)))
+    content.append(buffer, count);
+  return content;
+}
+
+TEST(FileTest, WriteGatherRetry) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  std::string payload(1000, 'x');
+  fmt::GatherWriter w(100);
+  w.write("<{}>", fmt::ref(payload));
+  writev_count = 1;
+  write_end.write(w);
+  EXPECT_EQ(4, writev_count);
+  writev_count = 0;
+  write_end.close();
+  EXPECT_EQ("<" + payload + ">", read_all(read_end));
+}
+
+TEST(FileTest, WriteGatherPartial) {
+  File read_end, write_end;
+  File::pipe(read_end, write_end);
+  std::string payload1(300, 'a'), payload2(200, 'b');
+  fmt::GatherWriter w(100);
+  w.write("{}|{}|{}|{}", fmt::ref(payload1), 42, fmt::ref(payload2), "end");
+  writev_max_bytes = 7;
+  write_end.write(w);
+  writev_max_bytes = 0;
+  write_end.close();
+  EXPECT_EQ(payload1 + "|42|" + payload2 + "|end", read_all(read_end));
+}
+#endif
+
 #ifdef _WIN32
 TEST(FileTest, ConvertReadCount) {
   File read_end, write_end;
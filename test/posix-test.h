@@ -32,7 +32,9 @@
 #include <stdio.h>
 
 #ifndef _WIN32
+# include <sys/types.h>
 struct stat;
+struct iovec;
 #else
 # include <windows.h>
 #endif
@@ -46,6 +48,9 @@ typedef ssize_t ssize_t;
 int open(const char *path, int oflag, int mode);
 int fstat(int fd, struct stat *buf);
 long sysconf(int name);
+void *mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off);
+int munmap(void *addr, size_t len);
+ssize_t writev(int fildes, const struct iovec *iov, int iovcnt);
 #else
 typedef unsigned size_t;
 typedef int ssize_t;
@@ -0,0 +1,119 @@
+/*
+ Test of the LD_PRELOAD replacements of the C library printf functions.
+
+ Copyright (c) 2012-2014, Victor Zverovich
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This program must be run with LD_PRELOAD set to libformat-preload.so. */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE  /* for RTLD_DEFAULT */
+#endif
+
+#include <dlfcn.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static int num_failures;
+
+#define CHECK(condition) \
+  if (!(condition)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", \
+            __FILE__, __LINE__, #condition); \
+    ++num_failures; \
+  }
+
+#define CHECK_SNPRINTF(expected, ...) { \
+  char buffer[256]; \
+  int size = snprintf(buffer, sizeof(buffer), __VA_ARGS__); \
+  CHECK(size == (int)strlen(expected) && strcmp(buffer, expected) == 0); \
+}
+
+/*
+ Returns nonzero if snprintf aborts on %n in a writable format string
+ the same way as the C library does with _FORTIFY_SOURCE=2.
+ */
+static int rejects_writable_n(void) {
+  int status = 0;
+  pid_t pid = fork();
+  if (pid == 0) {
+    char format[] = "a%nb";
+    char buffer[8];
+    int n = 0;
+    close(STDERR_FILENO);  /* Hide the error message. */
+    snprintf(buffer, sizeof(buffer), format, &n);
+    _exit(0);
+  }
+  if (pid < 0 || waitpid(pid, &status, 0) != pid)
+    return 0;
+  return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+int main(void) {
+  char buffer[16];
+  int n = 0;
+  FILE *f = 0;
+
+  if (!dlsym(RTLD_DEFAULT, "fmt_vsnprintf")) {
+    fprintf(stderr, "libformat-preload.so is not preloaded\n");
+    return 1;
+  }
+
+  CHECK_SNPRINTF("42", "%d", 42);
+  CHECK_SNPRINTF("[  -42|ff  |0x00cafe]", "[%5d|%-4x|%#08x]", -42, 255u, 0xcafeu);
+  CHECK_SNPRINTF("18446744073709551615 -1", "%llu %ld",
+                 18446744073709551615ull, -1L);
+  CHECK_SNPRINTF("abc|  x|%", "%s|%3c|%%", "abc", 'x');
+  /* Floating-point formatting calls snprintf recursively. */
+  CHECK_SNPRINTF("3.14 1.000000e+10", "%.2f %e", 3.14159, 1e10);
+  /* Passed to the C library. */
+  CHECK_SNPRINTF("b a", "%2$s %1$s", "a", "b");
+  CHECK_SNPRINTF("(null)", "%s", (const char*)0);
+  CHECK_SNPRINTF("ab", "a%nb", &n);
+  CHECK(n == 1);
+  CHECK(rejects_writable_n());
+
+  /* Truncation. */
+  CHECK(snprintf(buffer, 4, "%d", 123456) == 6);
+  CHECK(strcmp(buffer, "123") == 0);
+  CHECK(sprintf(buffer, "%x", 48879u) == 4);
+  CHECK(strcmp(buffer, "beef") == 0);
+
+  f = tmpfile();
+  CHECK(f != 0);
+  if (f) {
+    CHECK(fprintf(f, "%s=%d\n", "answer", 42) == 10);
+    rewind(f);
+    CHECK(fgets(buffer, sizeof(buffer), f) != 0);
+    CHECK(strcmp(buffer, "answer=42\n") == 0);
+    fclose(f);
+  }
+
+  if (num_failures != 0)
+    fprintf(stderr, "%d check(s) failed\n", num_failures);
+  return num_failures != 0;
+}
@@ -559,7 +559,7 @@ TEST(ArgTest, MakeArg) {
   fmt::MemoryWriter w;
   fmt::BasicFormatter<char> formatter(w);
   const char *s = "}";
-  arg.custom.format(&formatter, &t, &s);
+  arg.custom.ops->format(&formatter, &t, &s);
   EXPECT_EQ("test", w.str());
 }
 
@@ -672,7 +672,9 @@ TEST(ArgVisitorTest, VisitUnhandledArg) {
   EXPECT_UNHANDLED(WSTR);
   const void *p = STR;
   EXPECT_UNHANDLED(p);
+#if FMT_USE_WCHAR
   EXPECT_UNHANDLED(::Test());
+#endif
 }
 
 TEST(ArgVisitorTest, VisitInvalidArg) {